@@ -0,0 +1,134 @@
+/*
+ * adc.c
+ * A/D converter service. The converter runs continuously in scan mode
+ * over PE0-PE3, and the RTI handler publishes a timestamped snapshot of
+ * all four channels every 4.1 ms, waking subscribers whose channel has
+ * crossed a threshold.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#include "adc.h"
+
+ISR_STUB(ADCISR, ADCHandler)
+
+typedef struct adc_subscription {
+	BOOL          Used;
+	int           Channel;
+	unsigned char High;      /* Rise above this value. */
+	unsigned char Low;       /* Fall below this value. */
+	BOOL          Above;     /* Last crossing was a rise. */
+	int           Sem;       /* Signalled on each crossing. */
+} adc_subscription;
+
+static volatile adc_snapshot ADCLatest;
+static adc_subscription ADCSubs[ADC_MAXSUB];
+
+void OS_ADCInit(void) {
+	unsigned int i;
+	BOOL I;
+
+	I = CheckInterruptMask();
+	OS_DI();
+
+	/* Activate A/D Converter...makes pins on Port E analog. */
+	Ports[M6811_OPTION] SET_BIT(M6811_BIT7);
+	/* Delay at least 100 microseconds */
+	for (i = 0; i < 50; i++);
+
+	/* SCAN:MULTI = 1:1, convert PE0-PE3 into ADR1-ADR4 over and over. */
+	Ports[M6811_ADCTL] = M6811_BIT5 | M6811_BIT4;
+
+	RTIV = ADCISR;
+
+	/* RTR1:RTR0 = 0:0, the fastest real time interrupt rate. */
+	Ports[M6811_PACTL] CLR_BIT(M6811_BIT1);
+	Ports[M6811_PACTL] CLR_BIT(M6811_BIT0);
+	/* Clear RTIF */
+	Ports[M6811_TFLG2] = M6811_BIT6;
+	/* Unmask RTI interrupt */
+	Ports[M6811_TMSK2] SET_BIT(M6811_BIT6);
+
+	if (!I) { OS_EI(); }
+}
+
+unsigned char OS_ADCRead(int channel) {
+	return ADCLatest.Value[channel];
+}
+
+void OS_ADCSnapshot(adc_snapshot *s) {
+	int i;
+
+	/* If the handler published while we were copying, copy again. */
+	do {
+		s->Seq = ADCLatest.Seq;
+		for (i = 0; i < ADC_CHANNELS; i++) {
+			s->Value[i] = ADCLatest.Value[i];
+		}
+		s->Time = ADCLatest.Time;
+	} while (s->Seq != ADCLatest.Seq);
+}
+
+int OS_ADCSubscribe(int channel, unsigned char threshold, unsigned char hysteresis, int s) {
+	adc_subscription *sub;
+	int i;
+	int id = ADC_INVALIDSUB;
+	BOOL I;
+
+	I = CheckInterruptMask();
+	OS_DI();
+
+	for (i = 0; i < ADC_MAXSUB; i++) {
+		sub = &ADCSubs[i];
+		if (!sub->Used) {
+			sub->Channel = channel;
+			sub->High    = (threshold > 255 - hysteresis) ? 255 : threshold + hysteresis;
+			sub->Low     = (threshold < hysteresis)       ? 0   : threshold - hysteresis;
+			sub->Above   = FALSE;
+			sub->Sem     = s;
+			sub->Used    = TRUE;
+			id = i;
+			break;
+		}
+	}
+
+	if (!I) { OS_EI(); }
+	return id;
+}
+
+void OS_ADCUnsubscribe(int sub) {
+	ADCSubs[sub].Used = FALSE;
+}
+
+BOOL OS_ADCAbove(int sub) {
+	return ADCSubs[sub].Above;
+}
+
+void ADCHandler(void) {
+	adc_subscription *sub;
+	unsigned char v;
+	int i;
+
+	/* Clear RTIF */
+	Ports[M6811_TFLG2] = M6811_BIT6;
+
+	ADCLatest.Value[0] = Ports[M6811_ADR1];
+	ADCLatest.Value[1] = Ports[M6811_ADR2];
+	ADCLatest.Value[2] = Ports[M6811_ADR3];
+	ADCLatest.Value[3] = Ports[M6811_ADR4];
+	ADCLatest.Time     = *(unsigned int*)&(Ports[M6811_TCNT_HIGH]);
+	ADCLatest.Seq++;
+
+	/* Wake subscribers whose channel has left its band. */
+	for (i = 0; i < ADC_MAXSUB; i++) {
+		sub = &ADCSubs[i];
+		if (!sub->Used) { continue; }
+
+		v = ADCLatest.Value[sub->Channel];
+		if ((!sub->Above && v > sub->High) || (sub->Above && v < sub->Low)) {
+			sub->Above = !sub->Above;
+			OS_Signal(sub->Sem);
+		}
+	}
+}
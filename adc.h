@@ -0,0 +1,77 @@
+/*
+ * adc.h
+ * A/D converter service. The converter runs continuously in scan mode
+ * over PE0-PE3, and the RTI handler publishes a timestamped snapshot of
+ * all four channels every 4.1 ms, waking subscribers whose channel has
+ * crossed a threshold.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#ifndef __ADC_H__
+#define __ADC_H__
+
+#include "os.h"
+#include "ports.h"
+#include "interrupts.h"
+#include "process.h"
+#include "isr.h"
+
+#define ADC_CHANNELS        4
+
+/* Max. # of threshold subscriptions. */
+#define ADC_MAXSUB          8
+
+/* An invalid subscription descriptor. */
+#define ADC_INVALIDSUB      -1
+
+/* Channels, see PORT E in ports.h. */
+#define ADC_RIGHT_LIGHT     0
+#define ADC_LEFT_LIGHT      1
+#define ADC_MICROPHONE      2
+#define ADC_BUMPERS         3
+
+typedef struct adc_snapshot {
+	unsigned char Value[ADC_CHANNELS]; /* ADR1-ADR4, i.e. PE0-PE3.       */
+	unsigned int  Time;                /* TCNT when the copy was taken.   */
+	unsigned int  Seq;                 /* Incremented on each snapshot.   */
+} adc_snapshot;
+
+/*
+   Power up the converter, start scanning PE0-PE3 and start publishing
+   snapshots on the RTI. May be called before OS_Start().
+*/
+void OS_ADCInit(void);
+
+/* Latest value of "channel". Never blocks or waits for a conversion. */
+unsigned char OS_ADCRead(int channel);
+
+/* Copy the latest snapshot of all channels into s. The copy is consistent. */
+void OS_ADCSnapshot(adc_snapshot *s);
+
+/*
+   Subscribe to "channel" crossing "threshold". The value rises when it goes
+   above threshold + hysteresis, and falls when it goes below threshold -
+   hysteresis. On each rise or fall, semaphore "s" is signalled, so the
+   subscriber can block in OS_Wait(s) and use no CPU while the value stays
+   in one band. The caller initializes s, normally to 0. Several
+   subscriptions may share a semaphore. The check runs in the RTI handler
+   on each fresh sample. A subscription starts in the low band.
+   Returns ADC_INVALIDSUB if none is available.
+*/
+int OS_ADCSubscribe(int channel, unsigned char threshold, unsigned char hysteresis, int s);
+
+/* Release subscription "sub". */
+void OS_ADCUnsubscribe(int sub);
+
+/* TRUE if the channel of "sub" last rose above its band, FALSE if it last fell below. */
+BOOL OS_ADCAbove(int sub);
+
+/* Publishes a snapshot from the result registers and checks the subscriptions. */
+void ADCHandler(void);
+
+/* RTI vector. ADCHandler() runs on IStack, so its subscriber loop costs process stacks nothing. */
+void ADCISR(void);
+
+#endif /* __ADC_H__ */
@@ -0,0 +1,114 @@
+/*
+ * filter.c
+ * Streaming filters for 8 bit sensor channels.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#include "filter.h"
+
+#define SWAP(a, b) { unsigned char t = a; a = b; b = t; }
+
+void FilterAverageInit(filter_average *f, unsigned char shift, unsigned char initial) {
+	unsigned char i;
+
+	if (shift > FILTER_MAX_SHIFT) { shift = FILTER_MAX_SHIFT; }
+
+	f->Shift = shift;
+	f->Next  = 0;
+	f->Sum   = 0;
+	for (i = 0; i < (1 << shift); i++) {
+		f->Window[i] = initial;
+		f->Sum      += initial;
+	}
+}
+
+unsigned char FilterAverage(filter_average *f, unsigned char x) {
+	/* Swap the oldest sample out of the running sum. */
+	f->Sum -= f->Window[f->Next];
+	f->Sum += x;
+	f->Window[f->Next] = x;
+	f->Next = (f->Next + 1) & ((1 << f->Shift) - 1);
+
+	return (unsigned char)(f->Sum >> f->Shift);
+}
+
+void FilterSmoothInit(filter_smooth *f, unsigned char shift, unsigned char initial) {
+	f->Shift = shift;
+	f->Value = (unsigned int)initial << 8;
+}
+
+unsigned char FilterSmooth(filter_smooth *f, unsigned char x) {
+	unsigned int in = (unsigned int)x << 8;
+
+	/* Kept unsigned by stepping up or down separately. */
+	if (in > f->Value) { f->Value += (in - f->Value) >> f->Shift; }
+	else               { f->Value -= (f->Value - in) >> f->Shift; }
+
+	/* Round to the nearest whole value. */
+	return (unsigned char)((f->Value + 0x80) >> 8);
+}
+
+void FilterMedianInit(filter_median *f, unsigned char initial) {
+	f->Last[0] = initial;
+	f->Last[1] = initial;
+	f->Last[2] = initial;
+	f->Last[3] = initial;
+}
+
+/* Push x into the history, newest first. */
+static void FilterMedianPush(filter_median *f, unsigned char x) {
+	f->Last[3] = f->Last[2];
+	f->Last[2] = f->Last[1];
+	f->Last[1] = f->Last[0];
+	f->Last[0] = x;
+}
+
+unsigned char FilterMedian3(filter_median *f, unsigned char x) {
+	unsigned char a = x, b = f->Last[0], c = f->Last[1];
+
+	FilterMedianPush(f, x);
+
+	if (a > b) SWAP(a, b);
+	if (b > c) SWAP(b, c);
+	return (a > b) ? a : b;
+}
+
+unsigned char FilterMedian5(filter_median *f, unsigned char x) {
+	unsigned char a = x, b = f->Last[0], c = f->Last[1], d = f->Last[2], e = f->Last[3];
+
+	FilterMedianPush(f, x);
+
+	/* Six compares: order two pairs, drop the smaller low, bring in e, repeat once. */
+	if (a > b) SWAP(a, b);
+	if (c > d) SWAP(c, d);
+	if (a < c) {
+		a = e;
+		if (a > b) SWAP(a, b);
+	}
+	else {
+		c = e;
+		if (c > d) SWAP(c, d);
+	}
+	if (a < c) { return (b < c) ? b : c; }
+	else       { return (d < a) ? d : a; }
+}
+
+void FilterPeakInit(filter_peak *f, unsigned char shift) {
+	f->Shift = shift;
+	f->Value = 0;
+}
+
+unsigned char FilterPeak(filter_peak *f, unsigned char x) {
+	if (x >= f->Value) {
+		f->Value = x;
+	}
+	else {
+		/* Always decay by at least one so the hold lets go eventually. */
+		f->Value -= ((f->Value - x) >> f->Shift) | 1;
+		/* The odd step can overshoot (a hold of 10 and a sample of 8 would give 7); never fall below the input. */
+		if (f->Value < x) { f->Value = x; }
+	}
+	return f->Value;
+}
@@ -0,0 +1,56 @@
+/*
+ * filter.h
+ * Streaming filters for 8 bit sensor channels. Each filter keeps its state
+ * in a small structure and takes one sample per call. Only 8 and 16 bit
+ * adds, compares and shifts are used, so no multiply or divide helpers
+ * are pulled in.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#ifndef __FILTER_H__
+#define __FILTER_H__
+
+/* Largest moving average window is 1 << FILTER_MAX_SHIFT samples. */
+#define FILTER_MAX_SHIFT 4
+
+typedef struct filter_average {
+	unsigned char Window[1 << FILTER_MAX_SHIFT];
+	unsigned int  Sum;                 /* Sum of the samples in Window.        */
+	unsigned char Shift;               /* log2 of the window length.           */
+	unsigned char Next;                /* Slot the next sample replaces.       */
+} filter_average;
+
+typedef struct filter_smooth {
+	unsigned int  Value;               /* Output in 8.8 fixed point.           */
+	unsigned char Shift;               /* Coefficient is 1 / (1 << Shift).     */
+} filter_smooth;
+
+typedef struct filter_median {
+	unsigned char Last[4];             /* Previous samples, newest first.      */
+} filter_median;
+
+typedef struct filter_peak {
+	unsigned char Value;               /* Held peak.                           */
+	unsigned char Shift;               /* Decay 1 / (1 << Shift) of the gap per sample. */
+} filter_peak;
+
+/* Moving average over 1 << shift samples, shift at most FILTER_MAX_SHIFT. Starts at "initial". */
+void FilterAverageInit(filter_average *f, unsigned char shift, unsigned char initial);
+unsigned char FilterAverage(filter_average *f, unsigned char x);
+
+/* Exponential smoothing, y += (x - y) / (1 << shift). Starts at "initial". */
+void FilterSmoothInit(filter_smooth *f, unsigned char shift, unsigned char initial);
+unsigned char FilterSmooth(filter_smooth *f, unsigned char x);
+
+/* Median of the last 3 or 5 samples. Both share the state; starts at "initial". */
+void FilterMedianInit(filter_median *f, unsigned char initial);
+unsigned char FilterMedian3(filter_median *f, unsigned char x);
+unsigned char FilterMedian5(filter_median *f, unsigned char x);
+
+/* Peak hold: jumps up to new peaks, then decays toward the input but never below it. Starts at 0. */
+void FilterPeakInit(filter_peak *f, unsigned char shift);
+unsigned char FilterPeak(filter_peak *f, unsigned char x);
+
+#endif /* __FILTER_H__ */
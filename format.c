@@ -0,0 +1,78 @@
+/*
+ * format.c
+ * Decimal and time formatting without division.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#include "format.h"
+
+static const unsigned int FormatPow10[5] = { 10000, 1000, 100, 10, 1 };
+
+/* Place values of mm:ss.cc in ms, with the separator that follows each digit. */
+static const unsigned long FormatTimePlaces[6] = { 600000, 60000, 10000, 1000, 100, 10 };
+static const char          FormatTimeSeparator[6] = { 0, ':', 0, '.', 0, 0 };
+
+/* Largest multiple of 100 minutes, in ms, that is subtracted in one step. */
+#define FORMAT_TIME_WRAP 6000000UL
+
+char *FormatDigits(char *buf, unsigned int v, int width) {
+	int i;
+	char d;
+
+	for (i = 0; i < 5; i++) {
+		d = '0';
+		while (v >= FormatPow10[i]) {
+			v -= FormatPow10[i];
+			d++;
+		}
+		/* Higher digits are worked out but not written. */
+		if (i >= 5 - width) {
+			*buf++ = d;
+		}
+	}
+	return buf;
+}
+
+int FormatUInt(char *buf, unsigned int v) {
+	int i, n;
+	char d;
+
+	n = 0;
+	for (i = 0; i < 5; i++) {
+		d = '0';
+		while (v >= FormatPow10[i]) {
+			v -= FormatPow10[i];
+			d++;
+		}
+		/* Skip leading zeros, but always write the units. */
+		if (n || d != '0' || i == 4) {
+			buf[n++] = d;
+		}
+	}
+	buf[n] = 0;
+	return n;
+}
+
+char *FormatTime(char *buf, unsigned long ms) {
+	int i;
+	char d;
+
+	while (ms >= FORMAT_TIME_WRAP) {
+		ms -= FORMAT_TIME_WRAP;
+	}
+
+	for (i = 0; i < 6; i++) {
+		d = '0';
+		while (ms >= FormatTimePlaces[i]) {
+			ms -= FormatTimePlaces[i];
+			d++;
+		}
+		*buf++ = d;
+		if (FormatTimeSeparator[i]) {
+			*buf++ = FormatTimeSeparator[i];
+		}
+	}
+	return buf;
+}
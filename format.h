@@ -0,0 +1,32 @@
+/*
+ * format.h
+ * Decimal and time formatting without division. Digits are produced by
+ * subtracting powers of ten from a table, so gcc's division helpers are
+ * never called. Output goes into buffers supplied by the caller.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#ifndef __FORMAT_H__
+#define __FORMAT_H__
+
+/* Characters written by FormatTime(). */
+#define FORMAT_TIME_LEN 8
+
+/*
+   Write the lowest "width" (1 to 5) decimal digits of v into buf, zero
+   padded, without a terminating null. Returns buf + width.
+*/
+char *FormatDigits(char *buf, unsigned int v, int width);
+
+/* Write v into buf without leading zeros, null terminated. Returns the number of digits. */
+int FormatUInt(char *buf, unsigned int v);
+
+/*
+   Write a time of "ms" milliseconds into buf as "mm:ss.cc" (minutes wrap
+   at 100), without a terminating null. Returns buf + FORMAT_TIME_LEN.
+*/
+char *FormatTime(char *buf, unsigned long ms);
+
+#endif /* __FORMAT_H__ */
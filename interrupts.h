@@ -8,6 +8,7 @@ typedef void (* interrupt_t) (void);
 #define VECTOR_BASE     0xBFC0
 
 
+#define IVPAOV  (*(interrupt_t *)(VECTOR_BASE + 0x1C))
 #define IVTOI   (*(interrupt_t *)(VECTOR_BASE + 0x1E))
 
 #define TOC5V   (*(interrupt_t *)(VECTOR_BASE + 0x20))
@@ -0,0 +1,113 @@
+/*
+ * ir.c
+ * Infrared obstacle detection. The emitters (PD2 left, PD3 right) are
+ * pulsed in turn, and the detector's response is timestamped by input
+ * capture instead of being sampled after a delay.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#include "ir.h"
+
+ISR_STUB(IRCaptureISR, IRCaptureHandler)
+
+static const unsigned char IREmitter[2] = { M6811_BIT2, M6811_BIT3 };
+
+static FIFO                  IRFifo;          /* Where detection events go.            */
+static volatile int          IRSide;          /* Side currently being pulsed.          */
+static volatile unsigned int IROnTime;        /* TCNT when its emitter switched on.    */
+static volatile BOOL         IRCaptured;      /* The detector answered this pulse.     */
+static volatile unsigned int IRLatency[2];    /* Emitter on to detector edge, ticks.   */
+static volatile int          IRState;         /* left + (right * 256), last published. */
+
+/* Publish the result of the pulse on the current side. Interrupts must be masked. */
+static void IRPublish(BOOL detected) {
+	int state;
+
+	state = IRState;
+	if (IRSide == IR_LEFT) { state = (state & 0xFF00) | (detected ? 1 : 0); }
+	else                   { state = (state & 0x00FF) | (detected ? 0x0100 : 0); }
+
+	if (state != IRState) {
+		IRState = state;
+		OS_Write(IRFifo, state);
+	}
+}
+
+/* Pulse the next side and arm the capture. Interrupts must be masked. */
+static void IRStep(void) {
+	/* The last pulse got no answer in a whole period: nothing there. */
+	if (!IRCaptured) {
+		Ports[M6811_TMSK1] CLR_BIT(IR_IC_FLAG);
+		Ports[M6811_PORTD] CLR_BIT(IREmitter[IRSide]);
+		IRPublish(FALSE);
+	}
+
+	IRSide     = (IRSide == IR_LEFT) ? IR_RIGHT : IR_LEFT;
+	IRCaptured = FALSE;
+
+	/* Clear IC1F, then start the pulse and note when it began. */
+	Ports[M6811_TFLG1] = IR_IC_FLAG;
+	Ports[M6811_PORTD] SET_BIT(IREmitter[IRSide]);
+	IROnTime = *(unsigned int*)&(Ports[M6811_TCNT_HIGH]);
+	Ports[M6811_TMSK1] SET_BIT(IR_IC_FLAG);
+}
+
+void IRDriver(void) {
+	OS_DI();
+
+	IRFifo     = (FIFO)OS_GetParam();
+	IRState    = 0;
+	IRSide     = IR_RIGHT;
+	IRCaptured = TRUE;
+
+	/* Emitters are outputs and start off. */
+	Ports[M6811_DDRD]  SET_BIT(M6811_BIT2|M6811_BIT3);
+	Ports[M6811_PORTD] CLR_BIT(M6811_BIT2);
+	Ports[M6811_PORTD] CLR_BIT(M6811_BIT3);
+
+	IR_IC_VECTOR = IRCaptureISR;
+
+	/* Capture on one edge only. */
+	if (IR_EDGE_FALLING) {
+		Ports[M6811_TCTL2] SET_BIT(IR_IC_EDGE_B);
+		Ports[M6811_TCTL2] CLR_BIT(IR_IC_EDGE_A);
+	}
+	else {
+		Ports[M6811_TCTL2] CLR_BIT(IR_IC_EDGE_B);
+		Ports[M6811_TCTL2] SET_BIT(IR_IC_EDGE_A);
+	}
+
+	OS_EI();
+
+	while (1) {
+		OS_DI();
+		IRStep();
+		OS_EI();
+		OS_Yield();
+	}
+}
+
+BOOL OS_IRRead(int side, unsigned int *latency) {
+	BOOL detected;
+
+	detected = (side == IR_LEFT) ? (IRState & 0x00FF) : (IRState & 0xFF00);
+	if (detected && latency) {
+		*latency = IRLatency[side];
+	}
+	return detected ? TRUE : FALSE;
+}
+
+void IRCaptureHandler(void) {
+	/* Only the first edge of a pulse counts. */
+	Ports[M6811_TMSK1] CLR_BIT(IR_IC_FLAG);
+	Ports[M6811_TFLG1] = IR_IC_FLAG;
+
+	IRLatency[IRSide] = *(unsigned int*)&(Ports[IR_TIC_HIGH]) - IROnTime;
+	IRCaptured = TRUE;
+
+	/* The answer is in; the emitter can go off early. */
+	Ports[M6811_PORTD] CLR_BIT(IREmitter[IRSide]);
+	IRPublish(TRUE);
+}
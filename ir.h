@@ -0,0 +1,63 @@
+/*
+ * ir.h
+ * Infrared obstacle detection. The emitters (PD2 left, PD3 right) are
+ * pulsed in turn, and the detector's response is timestamped by input
+ * capture instead of being sampled after a delay.
+ *
+ * The detector is read on PE4, which cannot capture edges, so its output
+ * must also be wired to PA2/IC1.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#ifndef __IR_H__
+#define __IR_H__
+
+#include "os.h"
+#include "ports.h"
+#include "interrupts.h"
+#include "process.h"
+#include "isr.h"
+
+#define IR_LEFT    0
+#define IR_RIGHT   1
+
+/* Rate of the IR DEVICE driver in ms; each side is pulsed every other period. */
+#define IR_PERIOD  5
+
+/* Input capture channel the detector is wired to: IC1 on PA2. */
+#define IR_TIC_HIGH      M6811_TIC1_HIGH
+#define IR_IC_FLAG       M6811_BIT2      /* IC1F in TFLG1, IC1I in TMSK1. */
+#define IR_IC_EDGE_B     M6811_BIT5      /* EDG1B in TCTL2. */
+#define IR_IC_EDGE_A     M6811_BIT4      /* EDG1A in TCTL2. */
+#define IR_IC_VECTOR     IC1V
+
+/* The detector pulls its output low when it sees the emitter: capture falling edges. */
+#define IR_EDGE_FALLING  1
+
+/*
+   Device: IR_PERIOD ms.
+   Parameter = FIFO to publish detection events to. An event is written
+   whenever either side changes, as left + (right * 256), with 1 meaning
+   an object is in front of that side.
+   Each activation ends one emitter pulse and starts the next, so a reading
+   costs one context switch; the detector edge itself is handled by the
+   input capture ISR.
+*/
+void IRDriver(void);
+
+/*
+   Latest reading of "side". Returns TRUE if an object was detected; if so
+   and "latency" is not null, it receives the time in timer ticks (8 usec)
+   from the emitter switching on to the detector responding.
+*/
+BOOL OS_IRRead(int side, unsigned int *latency);
+
+/* Timestamps the detector edge of the current pulse. */
+void IRCaptureHandler(void);
+
+/* Input capture vector: IRCaptureHandler() on the interrupt stack. */
+void IRCaptureISR(void);
+
+#endif /* __IR_H__ */
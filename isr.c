@@ -0,0 +1,57 @@
+/*
+ * isr.c
+ * Interrupt stack.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#include "isr.h"
+
+#define ISR_STR(x)  #x
+#define ISR_XSTR(x) ISR_STR(x)
+
+/* The interrupt stack always goes in the reserved stacks region. */
+char IStack[ISTACK_SIZE] __attribute__((section(".stacks")));
+
+unsigned char ISRDepth;   /* Handlers currently running on IStack.    */
+char *ISRSavedSP;         /* SP of the interrupted code, with its frame. */
+
+/*
+   Common entry for every ISR_STUB(), with the handler's address in X. The 
+   CPU has already stacked the registers and masked interrupts. Only the 
+   outermost handler switches stacks, in case a handler unmasks interrupts. 
+   The soft registers are saved as __attribute__((interrupt)) would have. 
+*/
+asm (" .pushsection .text \n"
+     " .globl ISREnter \n"
+     "ISREnter: \n"
+     " tst  ISRDepth \n"
+     " bne  1f \n"
+     " sts  ISRSavedSP \n"
+     " lds  #IStack+" ISR_XSTR(ISTACK_SIZE) "-1 \n"
+     "1: \n"
+     " inc  ISRDepth \n"
+     " ldy  _.tmp \n"
+     " pshy \n"
+     " ldy  _.z \n"
+     " pshy \n"
+     " ldy  _.xy \n"
+     " pshy \n"
+     " ldy  _.frame \n"
+     " pshy \n"
+     " jsr  0,x \n"
+     " puly \n"
+     " sty  _.frame \n"
+     " puly \n"
+     " sty  _.xy \n"
+     " puly \n"
+     " sty  _.z \n"
+     " puly \n"
+     " sty  _.tmp \n"
+     " dec  ISRDepth \n"
+     " bne  2f \n"
+     " lds  ISRSavedSP \n"
+     "2: \n"
+     " rti \n"
+     " .popsection ");
@@ -0,0 +1,38 @@
+/*
+ * isr.h
+ * Interrupt stack. Driver interrupt handlers are entered through a short 
+ * stub that moves SP onto IStack, saves the compiler's soft registers 
+ * there, and calls the handler as an ordinary function. Only the 9 byte 
+ * frame the CPU stacks itself lands on the interrupted process's stack, 
+ * so process stacks need no room for handler frames. 
+ *
+ * OC4 and SWI are not entered this way: their frames on the process stack 
+ * are the process's saved context. 
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#ifndef __ISR_H__
+#define __ISR_H__
+
+#include "os.h"
+#include "process.h"
+
+extern char IStack[];              /* Interrupt stack, ISTACK_SIZE bytes. */
+
+/*
+   Define "stub" as an interrupt vector entry for "handler". The handler is 
+   a plain void function, without __attribute__((interrupt)), and runs on 
+   IStack with interrupts masked. Use at file scope: 
+       ISR_STUB(ToneISR, ToneHandler)
+*/
+#define ISR_STUB(stub, handler) \
+	asm (" .pushsection .text \n" \
+	     " .globl " #stub " \n" \
+	     #stub ": \n" \
+	     " ldx #" #handler " \n" \
+	     " jmp ISREnter \n" \
+	     " .popsection ");
+
+#endif /* __ISR_H__ */
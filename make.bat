@@ -1,4 +1,4 @@
 @echo on
-m6811-elf-gcc -g -mshort -Wl,-m,m68hc11elfb -O -msoft-reg-count=0 test.c lcd.c process.c semaphore.c fifo.c os.c -o os.elf
+m6811-elf-gcc -g -mshort -Wl,-m,m68hc11elfb -O -msoft-reg-count=0 -DOS_WORKSPACE=224 test.c lcd.c process.c isr.c semaphore.c fifo.c tone.c morse.c motor.c odometry.c ir.c adc.c mic.c filter.c format.c task.c timer.c os.c -o os.elf
 m6811-elf-objcopy --only-section=.text --only-section=.rodata --only-section=.vectors --only-section=.data --output-target=srec os.elf os.s19
 
@@ -17,6 +17,10 @@ SECTIONS
        {
          *(.lcd)
        } > lcdbuf
+    .stacks (NOLOAD) :
+       {
+         *(.stacks)
+       } > stacks
 }
 
 PROVIDE (_stack = 0xFFBF);
\ No newline at end of file
@@ -0,0 +1,149 @@
+/*
+ * mic.c
+ * Microphone sampling pipeline. The microphone is sampled by a lean OC5
+ * handler at a fixed rate into a ring buffer, and a stackless task reduces
+ * each block of samples to envelope and peak figures.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#include "mic.h"
+
+#define MIC_STR(x)  #x
+#define MIC_XSTR(x) MIC_STR(x)
+
+/* Global so the handler below can reach them by name. */
+unsigned char MicRing[MIC_RING_SIZE];
+volatile unsigned char MicWrite;             /* Samples taken, mod 256; MicRing slot is this mod MIC_RING_SIZE. */
+unsigned int MicPeriod;                      /* Ticks between samples.            */
+
+static FIFO MicFifo;
+static BOOL MicRunning;                      /* Sampling is on.                   */
+static BOOL MicTaskLive;                     /* MicReduce() is still released.    */
+static unsigned char MicRead;                /* Next sample MicReduce() takes.    */
+
+static unsigned int  MicSum;                 /* Rectified sum over this block.    */
+static unsigned char MicPeak;                /* Largest rectified sample so far.  */
+static unsigned char MicCount;               /* Samples taken in this block.      */
+
+static volatile unsigned char MicEnvelope;   /* Figures of the last whole block.  */
+static volatile unsigned char MicLastPeak;
+
+/*
+   OC5 vector while sampling. It only stores the converter's latest
+   microphone value and moves TOC5 on, about 60 E-cycles plus the CPU's
+   own stacking, all on the interrupted stack with no soft registers
+   touched. The block figures are worked out by MicReduce().
+*/
+asm (" .pushsection .text \n"
+     " .globl MicISR \n"
+     "MicISR: \n"
+     " ldx  #MicRing \n"
+     " ldab MicWrite \n"
+     " andb #" MIC_XSTR(MIC_RING_SIZE) "-1 \n"
+     " abx \n"
+     " ldaa " MIC_XSTR(PORT_BASE) "+" MIC_XSTR(M6811_ADR1) "+" MIC_XSTR(ADC_MICROPHONE) " \n"
+     " staa 0,x \n"
+     " inc  MicWrite \n"
+     " ldd  " MIC_XSTR(PORT_BASE) "+" MIC_XSTR(M6811_TOC5_HIGH) " \n"
+     " addd MicPeriod \n"
+     " std  " MIC_XSTR(PORT_BASE) "+" MIC_XSTR(M6811_TOC5_HIGH) " \n"
+     " ldaa #0x08 \n"
+     " staa " MIC_XSTR(PORT_BASE) "+" MIC_XSTR(M6811_TFLG1) " \n"
+     " rti \n"
+     " .popsection ");
+
+/* Stackless task: fold the samples taken since the last release into blocks. */
+static char MicReduce(task *t) {
+	unsigned char s;
+
+	if (!MicRunning) {
+		MicTaskLive = FALSE;
+		return TASK_ENDED;
+	}
+
+	while (MicRead != MicWrite) {
+		s = MicRing[MicRead++ & (MIC_RING_SIZE - 1)];
+
+		/* Rectify the sound sample around 128. */
+		s = (s & 0x80) ? s - 128 : 128 - s;
+
+		MicSum += s;
+		if (s > MicPeak) { MicPeak = s; }
+
+		if (++MicCount == MIC_BLOCK_SIZE) {
+			MicEnvelope = (unsigned char)(MicSum >> MIC_BLOCK_SHIFT);
+			MicLastPeak = MicPeak;
+			OS_Write(MicFifo, MicEnvelope + (MicLastPeak << 8));
+			MicSum   = 0;
+			MicPeak  = 0;
+			MicCount = 0;
+		}
+	}
+	return TASK_YIELDED;
+}
+
+BOOL OS_MicStart(FIFO f, unsigned int rate) {
+	BOOL I;
+
+	if (rate > MIC_MAX_RATE) { rate = MIC_MAX_RATE; }
+	if (rate < MIC_MIN_RATE) { rate = MIC_MIN_RATE; }
+
+	I = CheckInterruptMask();
+	OS_DI();
+
+	/* A task that is still winding down from OS_MicStop() just carries on. */
+	if (!MicTaskLive) {
+		if (OS_CreateTask(MicReduce, 0, MIC_REDUCE_RATE) == INVALIDTASK) {
+			if (!I) { OS_EI(); }
+			return FALSE;
+		}
+		MicTaskLive = TRUE;
+	}
+
+	MicFifo    = f;
+	MicRead    = MicWrite;
+	MicSum     = 0;
+	MicPeak    = 0;
+	MicCount   = 0;
+	MicRunning = TRUE;
+	MicPeriod  = (unsigned int)(((unsigned long)TIME_QUANTUM * 1000) / rate);
+	OS_ToneIdle(MicISR, MicPeriod);
+
+	if (!I) { OS_EI(); }
+	return TRUE;
+}
+
+void OS_MicStop(void) {
+	BOOL I;
+
+	I = CheckInterruptMask();
+	OS_DI();
+	OS_ToneIdle(0, 0);
+	MicRunning = FALSE;
+	if (!I) { OS_EI(); }
+}
+
+void OS_MicRead(unsigned char *envelope, unsigned char *peak) {
+	BOOL I;
+
+	I = CheckInterruptMask();
+	OS_DI();
+	*envelope = MicEnvelope;
+	*peak     = MicLastPeak;
+	if (!I) { OS_EI(); }
+}
+
+void OS_MicSamples(unsigned char *buf, int n) {
+	unsigned char i;
+	BOOL I;
+
+	I = CheckInterruptMask();
+	OS_DI();
+	i = MicWrite - n;
+	while (n--) {
+		*buf++ = MicRing[i++ & (MIC_RING_SIZE - 1)];
+	}
+	if (!I) { OS_EI(); }
+}
@@ -0,0 +1,69 @@
+/*
+ * mic.h
+ * Microphone sampling pipeline. The microphone is sampled by a lean OC5
+ * handler at a fixed rate into a ring buffer, and a stackless task reduces
+ * each block of samples to envelope and peak figures.
+ *
+ * OC5 is shared with the tone driver: sampling pauses while the speaker
+ * plays, which also keeps the robot from hearing itself.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#ifndef __MIC_H__
+#define __MIC_H__
+
+#include "os.h"
+#include "ports.h"
+#include "process.h"
+#include "adc.h"
+#include "tone.h"
+#include "task.h"
+
+/* Samples per block, a power of two; MIC_BLOCK_SHIFT is its log2. */
+#define MIC_BLOCK_SHIFT  6
+#define MIC_BLOCK_SIZE   (1 << MIC_BLOCK_SHIFT)
+
+/* Raw samples kept for consumers that want the waveform. */
+#define MIC_RING_SIZE    128
+
+/*
+   Highest sampling rate in Hz. Each sample costs about 75 E-cycles in
+   MicISR, counting the CPU's stacking and rti, and about as much again
+   in MicReduce(): some 30% of the CPU at 5 kHz.
+*/
+#define MIC_MAX_RATE     5000
+
+/* Lowest sampling rate in Hz; below this the period no longer fits in 16 bits of TCNT. */
+#define MIC_MIN_RATE     2
+
+/* Release period of MicReduce() in ms; MIC_RING_SIZE must outlast it at MIC_MAX_RATE. */
+#define MIC_REDUCE_RATE  8
+
+/*
+   Start sampling the microphone at "rate" Hz, in the kHz range. The A/D
+   service must have been started with OS_ADCInit(). After each block of
+   MIC_BLOCK_SIZE samples, an event is written to FIFO "f" as
+   envelope + (peak * 256): the mean and largest distance from 128 over
+   the block. Blocks are reduced by a stackless task every
+   MIC_REDUCE_RATE ms. Returns FALSE if no task is free.
+*/
+BOOL OS_MicStart(FIFO f, unsigned int rate);
+
+/* Stop sampling. */
+void OS_MicStop(void);
+
+/* Figures of the last completed block. */
+void OS_MicRead(unsigned char *envelope, unsigned char *peak);
+
+/*
+   Copy the "n" most recent raw samples, oldest first, into "buf".
+   n must not exceed MIC_RING_SIZE.
+*/
+void OS_MicSamples(unsigned char *buf, int n);
+
+/* OC5 vector while sampling; takes one sample. */
+void MicISR(void);
+
+#endif /* __MIC_H__ */
@@ -0,0 +1,92 @@
+/*
+ * morse.c
+ * Morse code sequencer. Characters are encoded from a bit-packed table
+ * into on/off steps on the tone queue, which the OC5 ISR plays back.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#include "morse.h"
+
+/* a-z followed by 0-9. */
+static const unsigned char MorseTable[36] = {
+	MORSE(2, 0x01),   /* a .-    */
+	MORSE(4, 0x08),   /* b -...  */
+	MORSE(4, 0x0A),   /* c -.-.  */
+	MORSE(3, 0x04),   /* d -..   */
+	MORSE(1, 0x00),   /* e .     */
+	MORSE(4, 0x02),   /* f ..-.  */
+	MORSE(3, 0x06),   /* g --.   */
+	MORSE(4, 0x00),   /* h ....  */
+	MORSE(2, 0x00),   /* i ..    */
+	MORSE(4, 0x07),   /* j .---  */
+	MORSE(3, 0x05),   /* k -.-   */
+	MORSE(4, 0x04),   /* l .-..  */
+	MORSE(2, 0x03),   /* m --    */
+	MORSE(2, 0x02),   /* n -.    */
+	MORSE(3, 0x07),   /* o ---   */
+	MORSE(4, 0x06),   /* p .--.  */
+	MORSE(4, 0x0D),   /* q --.-  */
+	MORSE(3, 0x02),   /* r .-.   */
+	MORSE(3, 0x00),   /* s ...   */
+	MORSE(1, 0x01),   /* t -     */
+	MORSE(3, 0x01),   /* u ..-   */
+	MORSE(4, 0x01),   /* v ...-  */
+	MORSE(3, 0x03),   /* w .--   */
+	MORSE(4, 0x09),   /* x -..-  */
+	MORSE(4, 0x0B),   /* y -.--  */
+	MORSE(4, 0x0C),   /* z --..  */
+	MORSE(5, 0x1F),   /* 0 ----- */
+	MORSE(5, 0x0F),   /* 1 .---- */
+	MORSE(5, 0x07),   /* 2 ..--- */
+	MORSE(5, 0x03),   /* 3 ...-- */
+	MORSE(5, 0x01),   /* 4 ....- */
+	MORSE(5, 0x00),   /* 5 ..... */
+	MORSE(5, 0x10),   /* 6 -.... */
+	MORSE(5, 0x18),   /* 7 --... */
+	MORSE(5, 0x1C),   /* 8 ---.. */
+	MORSE(5, 0x1E),   /* 9 ----. */
+};
+
+BOOL OS_MorseChar(char c) {
+	unsigned char m;
+	unsigned char bit;
+	int len;
+	BOOL I;
+
+	if      (c >= 'a' && c <= 'z') { m = MorseTable[c - 'a']; }
+	else if (c >= 'A' && c <= 'Z') { m = MorseTable[c - 'A']; }
+	else if (c >= '0' && c <= '9') { m = MorseTable[26 + c - '0']; }
+	/* The gap after the previous character is 3 units, a word gap is 7. */
+	else if (c == ' ')             { return OS_ToneQueue(0, 4 * MORSE_UNIT); }
+	else                           { return TRUE; }
+
+	len = MORSE_LEN(m);
+
+	/* Queue the whole character or nothing, so a full queue never splits one. */
+	I = CheckInterruptMask();
+	OS_DI();
+	if (OS_ToneQueueFree() < MORSE_MAX_STEPS) {
+		if (!I) { OS_EI(); }
+		return FALSE;
+	}
+
+	for (bit = 1 << (len - 1); bit; bit >>= 1) {
+		OS_ToneQueue(MORSE_FREQ, (m & bit) ? 3 * MORSE_UNIT : MORSE_UNIT);
+		/* 1 unit between symbols, 3 after the last one. */
+		OS_ToneQueue(0, (bit == 1) ? 3 * MORSE_UNIT : MORSE_UNIT);
+	}
+
+	if (!I) { OS_EI(); }
+	return TRUE;
+}
+
+void OS_Morse(char *s) {
+	for (; *s; s++) {
+		/* The queue drains from the OC5 ISR; let other processes run meanwhile. */
+		while (!OS_MorseChar(*s)) {
+			OS_Yield();
+		}
+	}
+}
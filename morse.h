@@ -0,0 +1,40 @@
+/*
+ * morse.h
+ * Morse code sequencer. Characters are encoded from a bit-packed table
+ * into on/off steps on the tone queue, which the OC5 ISR plays back.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#ifndef __MORSE_H__
+#define __MORSE_H__
+
+#include "os.h"
+#include "tone.h"
+
+#define MORSE_FREQ  880          /* Tone of a symbol in Hz.            */
+#define MORSE_UNIT  60           /* Length of a dot in ms.             */
+
+/* Table entry: symbol count in the top 3 bits, symbols (1 = dash) in the low 5, first symbol highest. */
+#define MORSE(len, bits)   (((len) << 5) | (bits))
+#define MORSE_LEN(m)       ((m) >> 5)
+
+/* Most steps a single character needs: five symbols, each followed by a gap. */
+#define MORSE_MAX_STEPS    10
+
+/*
+   Queue the character c. Letters, digits and spaces are sent, anything else
+   is skipped. Returns FALSE, queueing nothing, if the tone queue cannot take
+   the whole character.
+*/
+BOOL OS_MorseChar(char c);
+
+/*
+   Queue the whole string s, a character at a time, yielding while the tone
+   queue is full. Returns once the last character is queued, not played.
+   Process level only.
+*/
+void OS_Morse(char *s);
+
+#endif /* __MORSE_H__ */
@@ -0,0 +1,130 @@
+/*
+ * motor.c
+ * Hardware PWM motor speed control. OC1 raises both enables at the start
+ * of each frame, OC2 and OC3 drop the left (PA6) and right (PA5) enables
+ * when their share of the frame is up.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#include "motor.h"
+
+ISR_STUB(MotorISR, MotorHandler)
+
+static volatile unsigned int MotorDuty[2];  /* High time of each enable in ticks. */
+static BOOL MotorRunning;
+
+/* Enable pin on port A, direction pin on port D, and OM:OL bits in TCTL1 of each motor. */
+static const unsigned char MotorEnable[2]    = { M6811_BIT6, M6811_BIT5 };
+static const unsigned char MotorDirection[2] = { M6811_BIT4, M6811_BIT5 };
+static const unsigned char MotorOM[2]        = { M6811_BIT7, M6811_BIT5 };
+static const unsigned char MotorOL[2]        = { M6811_BIT6, M6811_BIT4 };
+
+/* Start the PWM frame. Interrupts must be masked. */
+static void MotorStart(void) {
+	unsigned int *TOC1_address;
+	unsigned int *timer_address;
+
+	/* Direction pins are outputs. */
+	Ports[M6811_DDRD] SET_BIT(M6811_BIT4|M6811_BIT5);
+
+	/* OC1 drives the enables high; which ones is chosen per motor in MotorSetOne(). */
+	Ports[M6811_OC1D] SET_BIT(M6811_BIT6|M6811_BIT5);
+
+	TOC1V = MotorISR;
+
+	/* Make sure these are read as single 16 bit numbers. */
+	TOC1_address  = (unsigned int*)&(Ports[M6811_TOC1_HIGH]);
+	timer_address = (unsigned int*)&(Ports[M6811_TCNT_HIGH]);
+	*TOC1_address = *timer_address + MOTOR_PWM_PERIOD;
+
+	/* Clear OC1F */
+	Ports[M6811_TFLG1] = M6811_BIT7;
+	/* Unmask OC1 interrupt */
+	Ports[M6811_TMSK1] SET_BIT(M6811_BIT7);
+
+	MotorRunning = TRUE;
+}
+
+/* Set direction and duty of motor m. Interrupts must be masked. */
+static void MotorSetOne(int m, int speed) {
+	unsigned int duty;
+
+	if (speed < 0) {
+		speed = -speed;
+		Ports[M6811_PORTD] CLR_BIT(MotorDirection[m]);
+	}
+	else {
+		Ports[M6811_PORTD] SET_BIT(MotorDirection[m]);
+	}
+	if (speed > MOTOR_MAX_SPEED) { speed = MOTOR_MAX_SPEED; }
+
+	/* x5 with a shift, so no multiply helper is pulled in. */
+	duty = ((unsigned int)speed << 2) + speed;
+	MotorDuty[m] = duty;
+
+	/* Stopped: OC1 leaves the pin alone, and OC2/OC3 hold it low. */
+	if (!duty) {
+		Ports[M6811_OC1M]  CLR_BIT(MotorEnable[m]);
+		Ports[M6811_TCTL1] SET_BIT(MotorOM[m]);
+		Ports[M6811_TCTL1] CLR_BIT(MotorOL[m]);
+		Ports[M6811_PORTA] CLR_BIT(MotorEnable[m]);
+	}
+	/* Full speed: OC1 raises the pin and OC2/OC3 never drop it. */
+	else if (duty >= MOTOR_PWM_PERIOD) {
+		Ports[M6811_OC1M]  SET_BIT(MotorEnable[m]);
+		Ports[M6811_TCTL1] CLR_BIT(MotorOM[m]);
+		Ports[M6811_TCTL1] CLR_BIT(MotorOL[m]);
+	}
+	/* OM:OL = 1:0, clear the pin on compare. */
+	else {
+		Ports[M6811_OC1M]  SET_BIT(MotorEnable[m]);
+		Ports[M6811_TCTL1] SET_BIT(MotorOM[m]);
+		Ports[M6811_TCTL1] CLR_BIT(MotorOL[m]);
+	}
+}
+
+void OS_MotorSet(int left, int right) {
+	BOOL I;
+
+	I = CheckInterruptMask();
+	OS_DI();
+
+	MotorSetOne(MOTOR_LEFT,  left);
+	MotorSetOne(MOTOR_RIGHT, right);
+
+	if (!MotorRunning) { MotorStart(); }
+
+	if (!I) { OS_EI(); }
+}
+
+void MotorHandler(void) {
+	unsigned int *TOC1_address;
+	unsigned int *timer_address;
+	unsigned int base;
+	unsigned int late;
+
+	/* OC1 has just raised the enables at "base"; schedule where they drop and the next frame. */
+	TOC1_address  = (unsigned int*)&(Ports[M6811_TOC1_HIGH]);
+	timer_address = (unsigned int*)&(Ports[M6811_TCNT_HIGH]);
+	base          = *TOC1_address;
+
+	*(unsigned int*)&(Ports[M6811_TOC2_HIGH]) = base + MotorDuty[MOTOR_LEFT];
+	*(unsigned int*)&(Ports[M6811_TOC3_HIGH]) = base + MotorDuty[MOTOR_RIGHT];
+	*TOC1_address = base + MOTOR_PWM_PERIOD;
+
+	/*
+	 * Each channel has a single compare register, so the drop can't be
+	 * queued a frame ahead without losing this frame's. If we ran late and
+	 * TCNT is already past a drop, the compare won't come round again for
+	 * a whole TCNT wrap; force it now instead. Forcing a compare that has
+	 * already happened just clears the pin again.
+	 */
+	late = *timer_address - base;
+	if (late >= MotorDuty[MOTOR_LEFT])  { Ports[M6811_CFORC] = M6811_BIT6; }
+	if (late >= MotorDuty[MOTOR_RIGHT]) { Ports[M6811_CFORC] = M6811_BIT5; }
+
+	/* Clear OC1F */
+	Ports[M6811_TFLG1] = M6811_BIT7;
+}
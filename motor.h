@@ -0,0 +1,43 @@
+/*
+ * motor.h
+ * Hardware PWM motor speed control. OC1 raises both enables at the start
+ * of each frame, OC2 and OC3 drop the left (PA6) and right (PA5) enables
+ * when their share of the frame is up.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#ifndef __MOTOR_H__
+#define __MOTOR_H__
+
+#include "os.h"
+#include "ports.h"
+#include "interrupts.h"
+#include "process.h"
+#include "isr.h"
+
+/* Speeds are percentages, negative for reverse. */
+#define MOTOR_MAX_SPEED   100
+
+/* PWM frame in timer ticks (4 ms, 250 Hz). Must be MOTOR_MAX_SPEED * 5. */
+#define MOTOR_PWM_PERIOD  500
+
+#define MOTOR_LEFT        0
+#define MOTOR_RIGHT       1
+
+/*
+   Set the speed of the left and right motors, from -MOTOR_MAX_SPEED (full
+   reverse) to MOTOR_MAX_SPEED (full forward). The first call starts the PWM
+   frame. The pins are then driven by the timer; the only CPU cost is a
+   short ISR that moves the compare registers on to the next frame.
+*/
+void OS_MotorSet(int left, int right);
+
+/* Starts each PWM frame by reloading TOC1, TOC2 and TOC3. */
+void MotorHandler(void);
+
+/* OC1 vector; MotorHandler() runs on IStack. */
+void MotorISR(void);
+
+#endif /* __MOTOR_H__ */
@@ -0,0 +1,68 @@
+/*
+ * odometry.c
+ * Wheel odometry from the pulse accumulator. Encoder pulses on PA7/PAI
+ * are counted in hardware; the PAOVF interrupt extends the 8 bit PACNT
+ * to 32 bits.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#include "odometry.h"
+
+ISR_STUB(OdometryOverflowISR, OdometryOverflowHandler)
+
+/* Number of times PACNT has wrapped, i.e. the upper 24 bits of the count. */
+static volatile unsigned long OdometryOverflows;
+
+void OS_OdometryInit(void) {
+	BOOL I;
+
+	I = CheckInterruptMask();
+	OS_DI();
+
+	IVPAOV = OdometryOverflowISR;
+
+	/* PA7 input, pulse accumulator enabled, event counting on rising edges. RTR1:RTR0 are left alone. */
+	Ports[M6811_PACTL] CLR_BIT(M6811_BIT7);
+	Ports[M6811_PACTL] SET_BIT(M6811_BIT6);
+	Ports[M6811_PACTL] CLR_BIT(M6811_BIT5);
+	Ports[M6811_PACTL] SET_BIT(M6811_BIT4);
+
+	Ports[M6811_PACNT] = 0;
+	OdometryOverflows  = 0;
+
+	/* Clear PAOVF */
+	Ports[M6811_TFLG2] = M6811_BIT5;
+	/* Unmask PAOV interrupt */
+	Ports[M6811_TMSK2] SET_BIT(M6811_BIT5);
+
+	if (!I) { OS_EI(); }
+}
+
+unsigned long OS_OdometryRead(void) {
+	unsigned long high;
+	unsigned char low;
+	BOOL pending;
+
+	/* Retry if the handler ran while we were reading; the 32 bit read itself is not atomic. */
+	do {
+		high = OdometryOverflows;
+		low  = Ports[M6811_PACNT];
+		/*
+		   PACNT has wrapped but the handler hasn't counted it yet. A large
+		   "low" was read just before the wrap, so it doesn't need the carry.
+		*/
+		pending = (Ports[M6811_TFLG2] & M6811_BIT5) && !(low & M6811_BIT7);
+	} while (high != OdometryOverflows);
+
+	if (pending) { high++; }
+
+	return (high << 8) | low;
+}
+
+void OdometryOverflowHandler(void) {
+	/* Clear PAOVF */
+	Ports[M6811_TFLG2] = M6811_BIT5;
+	OdometryOverflows++;
+}
@@ -0,0 +1,39 @@
+/*
+ * odometry.h
+ * Wheel odometry from the pulse accumulator. Encoder pulses on PA7/PAI
+ * are counted in hardware; the PAOVF interrupt extends the 8 bit PACNT
+ * to 32 bits.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#ifndef __ODOMETRY_H__
+#define __ODOMETRY_H__
+
+#include "os.h"
+#include "ports.h"
+#include "interrupts.h"
+#include "process.h"
+#include "isr.h"
+
+/*
+   Start counting rising edges on PA7 from zero. May be called before
+   OS_Start(), or again later to reset the count.
+*/
+void OS_OdometryInit(void);
+
+/*
+   Return the number of pulses counted since OS_OdometryInit(). The value is
+   a consistent snapshot of the software and hardware halves, taken without
+   masking interrupts; it may be called from processes or handlers.
+*/
+unsigned long OS_OdometryRead(void);
+
+/* Counts PACNT overflows. */
+void OdometryOverflowHandler(void);
+
+/* PAOV vector stub for OdometryOverflowHandler(). */
+void OdometryOverflowISR(void);
+
+#endif /* __ODOMETRY_H__ */
@@ -26,6 +26,8 @@
 #include "fifo.h" 
 #include "semaphore.h"
 #include "interrupts.h"
+#include "task.h"
+#include "timer.h"
 #include "test.h"
 
 int main(void) {
@@ -61,10 +63,13 @@ void OS_Init(void) {
 
 	/* Initialize the clock */ 
 	Clock    = 0;	
+	Ticks    = 0; 
 	ClockUpdate(); 
 
 	DevP       = 0;
 	SpoP       = 0; 
+	SporadicQuantum = MS_TO_TICKS(SPORADIC_QUANTUM); 
+	SporadicEDF     = FALSE; 
 	PCurrent   = 0; 
 	PKernel.SP = 0; 
 
@@ -73,8 +78,6 @@ void OS_Init(void) {
 		P[i].pid = INVALIDPID; 
 		P[i].Prev = 0; 
 		P[i].Next = 0;
-		/* Initial stack pointer points at the end of the stack. */ 
-		P[i].ISP = &(P[i].Stack[WORKSPACE-1]); 
 	}	
 
 	/* Initialize fifos. */ 
@@ -85,19 +88,295 @@ void OS_Init(void) {
 	/* Set up the idle process. */ 
 	IdleProcess.pid  = INVALIDPID; 
 	IdleProcess.Name = IDLE; 
-	IdleProcess.ISP  = &(IdleProcess.Stack[WORKSPACE-1]);
+	IdleProcess.SP   = &(IdleStack[WORKSPACE-1]);
 	IdleProcess.program_location = &Idle; 
 	IdleProcess.state = NEW;
+	IdleProcess.Prio  = MAXPRIO; 
 }
  
+/* Plan staged by OS_SetPlan(), waiting for the end of the current cycle. */ 
+static int  PlanPPP[MAXPROCESS]; 
+static int  PlanMax[MAXPROCESS]; 
+static int  PlanLen; 
+static BOOL PlanPending; 
+
+#ifndef FIXED_PRIORITY
+/* PPP[] and SPORADIC scheduling state, kept from one pass of the scheduler to the next. */ 
+static int      SlotIndex;  /* Queue index of the current periodic slot. */ 
+static tick_t   SlotEnd;    /* End of the current periodic slot, in ticks. */ 
+static BOOL     SlotDone;   /* The current slot's process has given up the rest of its slot. */ 
+static process *SpoOwner;   /* Sporadic process the quantum belongs to. */ 
+static tick_t   SpoLeft;    /* What is left of SpoOwner's quantum, in ticks. */ 
+
+/* 
+   Length of PPP[] slot i in ticks. An entry of zero or less, which only a 
+   PPPMax[] written directly can hold, counts as one tick, so the slot is 
+   skipped over rather than the scheduler never getting past it. 
+*/ 
+static tick_t SlotLength(int i) {
+	if (PPPMax[i] <= 0) { return 1; }
+	return PPPMaxTicks ? (tick_t)PPPMax[i] : MS_TO_TICKS(PPPMax[i]); 
+}
+
+/* Close the books on a slot: fold the time its process ran into the entry's statistics. */ 
+static void SlotFinish(slot_stats *st) {
+	if (st->Used) {
+		if (st->Used > st->Max) { st->Max = st->Used; }
+		/* Quick to rise and slow to fall, so it settles near the top of the run times. */ 
+		if (st->Used > st->High) { st->High += (st->Used - st->High) >> 1; }
+		else                     { st->High -= (st->High - st->Used) >> 4; }
+	}
+	st->Used = 0; 
+}
+
+/* 
+   Auto-tune, at a cycle boundary: give each entry a budget of its high 
+   run time plus a quarter plus AUTOTUNE_MARGIN, or its whole slot again 
+   if it overran in the last cycle or the budget would not be shorter 
+   than the slot anyway. 
+*/ 
+static void SlotTune(void) {
+	slot_stats *st; 
+	tick_t b; 
+	int i; 
+
+	for (i = 0; i < PPPLen; i++) {
+		st = &PPPStats[i]; 
+		b  = (tick_t)st->High + (st->High >> 2) + AUTOTUNE_MARGIN; 
+		if (PPP[i] == IDLE || PPP[i] == SERVER || st->Overran || !st->High || b >= SlotLength(i)) {
+			st->Budget = 0; 
+		}
+		else {
+			st->Budget = (unsigned int)b; 
+		}
+		st->Overran = FALSE; 
+	}
+}
+
+/* Make the staged plan current. Kernel only, at a cycle boundary. */ 
+static void PlanSwap(void) {
+	int i; 
+
+	/* Statistics and budgets belong to entries of the old plan. */ 
+	for (i = 0; i < MAXPROCESS; i++) {
+		PPPStats[i].Used     = 0; 
+		PPPStats[i].Max      = 0; 
+		PPPStats[i].High     = 0; 
+		PPPStats[i].Overruns = 0; 
+		PPPStats[i].Budget   = 0; 
+		PPPStats[i].Overran  = FALSE; 
+	}
+	for (i = 0; i < PlanLen; i++) {
+		PPP[i]    = PlanPPP[i]; 
+		PPPMax[i] = PlanMax[i]; 
+	}
+	PPPLen      = PlanLen; 
+	PlanPending = FALSE; 
+}
+
+/* 
+   Start the first slot of PPP[] now. Every later boundary is the previous 
+   one plus a slot length, so the cycle never drifts, however late the 
+   kernel gets to it. 
+*/ 
+static void SlotStart(void) {
+	SlotIndex = 0; 
+	SlotEnd   = Ticks + (PPPLen ? SlotLength(0) : 0); 
+	SlotDone  = FALSE; 
+}
+
+/* 
+   With no device process due, run the PERIODIC process of the current 
+   slot, a SPORADIC process or the idle process, until at most "t": the 
+   next device release, task or timer. 
+*/ 
+static void ScheduleSlot(tick_t t) {
+	process *p; 
+	tick_t start;   /* When a periodic or sporadic process was switched to, in ticks. */ 
+	tick_t used;    /* Time a periodic process has run in its slot, in ticks. */ 
+	slot_stats *st; /* Statistics of the current PPP[] entry. */ 
+	BOOL serving;   /* The sporadic process is charged to the server. */ 
+	BOOL sliced;    /* The sporadic process runs for a quantum. */ 
+
+	serving = FALSE; 
+
+	/* A plan staged while there was none starts straight away. */ 
+	if (PlanPending && !PPPLen) {
+		PlanSwap(); 
+		SlotStart(); 
+	}
+
+	/* Move on to the slot we are in. Slots the kernel was too late for are skipped. */ 
+	while (PPPLen && !TICKS_BEFORE(Ticks, SlotEnd)) {
+		SlotFinish(&PPPStats[SlotIndex]); 
+		circularIncrement(&SlotIndex, PPPLen); 
+		if (!SlotIndex) {
+			/* A staged plan takes over when the current cycle completes. */ 
+			if (PlanPending) { 
+				PlanSwap(); 
+				if (!PPPLen) { break; }
+			}
+			else if (PPPAutoTune) {
+				SlotTune(); 
+			}
+		}
+		SlotEnd += SlotLength(SlotIndex); 
+		SlotDone = FALSE; 
+	}
+
+	/* No device processes to run *now*, so try for a periodic process. */ 
+	if (PPPLen) {
+		/* The periodic process may run until the end of its slot, t. */ 
+		if (TICKS_BEFORE(SlotEnd, t)) {
+			t = SlotEnd; 
+		}
+
+		/* If the current slot isn't idle, a server slot or finished, try to look its process up. */ 
+		if (PPP[SlotIndex] != IDLE && PPP[SlotIndex] != SERVER && !SlotDone) {
+			PCurrent = GetPeriodicProcessByName(PPP[SlotIndex]); 	
+		}
+
+		/* 
+		   With a server set, pending SPORADIC work goes ahead of the 
+		   slot's PERIODIC process while the server has capacity, and the 
+		   time it takes is charged to the server. Once the capacity is 
+		   spent the PERIODIC process gets its slot back until the next 
+		   replenishment. 
+		*/ 
+		if (PCurrent && SpoP && ServerBudget) {
+			while (!TICKS_BEFORE(Ticks, ServerReplenish)) {
+				ServerLeft       = ServerBudget; 
+				ServerReplenish += ServerPeriod; 
+			}
+			if (ServerLeft) {
+				if (TICKS_BEFORE(Ticks + ServerLeft, t)) { t = Ticks + ServerLeft; }
+				serving  = TRUE; 
+				PCurrent = 0; 
+			}
+			else if (TICKS_BEFORE(ServerReplenish, t)) {
+				t = ServerReplenish; 
+			}
+		}
+
+		/* If a periodic process is ready to run, run it. */ 
+		if (PCurrent) {
+			/* A tuned budget ends its turn before the slot does; the rest of the slot goes to sporadic work. */ 
+			st = &PPPStats[SlotIndex]; 
+			if (st->Budget && TICKS_BEFORE(Ticks + (st->Budget - st->Used), t)) {
+				t = Ticks + (st->Budget - st->Used); 
+			}
+
+			Yielded = FALSE; 
+			start   = Ticks; 
+			SetPreemptionTicks(t);
+			ContextSwitchToProcess();
+			ClockUpdate();
+
+			/* Record the time it ran in this slot. */ 
+			used     = st->Used + (Ticks - start); 
+			st->Used = (used > 0xFFFF) ? 0xFFFF : (unsigned int)used; 
+
+			/* 
+			   Preempted at the end of the slot or budget, or early by a 
+			   device release or a PreemptAt(); either way the scheduler 
+			   takes it from here, and it carries on if its slot is still 
+			   current. Still running at the end is an overrun. 
+			*/ 
+			if (!Yielded) {
+				if (!TICKS_BEFORE(Ticks, t) 
+				    && (!TICKS_BEFORE(Ticks, SlotEnd) || (st->Budget && st->Used >= st->Budget))) {
+					st->Overruns++; 
+					st->Overran = TRUE; 
+					SlotDone    = TRUE; 
+				}
+				return; 
+			}
+			/* Otherwise it gave up the rest of its slot, by yielding, blocking or ending: go on to schedule a sporadic process or idle time. */ 
+			SlotDone = TRUE; 
+			PCurrent = 0; 
+		}
+	}
+
+	/* We're here so we must be idle and there must be no sporadic processes to run. */ 
+	if (!SpoP) {
+		PCurrent = &IdleProcess; 
+		SetPreemptionTicks(t);	
+		ContextSwitchToProcess(); 
+		return; 
+	}
+
+	/* We're here so we must be idle, or the server is taking a periodic slot's time. Schedule a sporadic process. */ 
+	PCurrent = SpoP; 
+
+	/* 
+	   EDF: the earliest deadline goes first, and a deadline that has 
+	   passed is counted once as a miss. Processes without one 
+	   follow, in queue order. 
+	*/ 
+	if (SporadicEDF) {
+		p = SpoP; 
+		do {
+			if (PSTATS(p).DeadlineState == DEADLINE_PENDING && TICKS_BEFORE(PSTATS(p).Deadline, Ticks)) {
+				PSTATS(p).DeadlineState = DEADLINE_MISSED; 
+				PSTATS(p).DeadlineMisses++; 
+			}
+			if (PSTATS(p).DeadlineState != DEADLINE_NONE 
+			    && (PSTATS(PCurrent).DeadlineState == DEADLINE_NONE || TICKS_BEFORE(PSTATS(p).Deadline, PSTATS(PCurrent).Deadline))) {
+				PCurrent = p; 
+			}
+		} while ((p = p->Next) && (p != SpoP)); 
+	}
+
+	/* 
+	   A process at the head keeps what is left of its quantum when 
+	   a device or periodic slot preempts it, and stays at the head. 
+	   Deadline jobs are not sliced. 
+	*/ 
+	sliced = SporadicQuantum && PSTATS(PCurrent).DeadlineState == DEADLINE_NONE; 
+	if (sliced) {
+		if (SpoOwner != PCurrent) {
+			SpoOwner = PCurrent; 
+			SpoLeft  = SporadicQuantum; 
+		}
+		if (TICKS_BEFORE(Ticks + SpoLeft, t)) { t = Ticks + SpoLeft; }
+	}
+
+	start = Ticks; 
+	SetPreemptionTicks(t);	
+	ContextSwitchToProcess(); 
+	ClockUpdate(); 
+
+	/* Charge the server for the sporadic time it just handed out. */ 
+	if (serving) {
+		ServerLeft = (Ticks - start < ServerLeft) ? ServerLeft - (Ticks - start) : 0; 
+	}
+
+	/* Quantum used up: to the back of the queue, unless it yielded or blocked meanwhile. */ 
+	if (sliced) {
+		if (Ticks - start >= SpoLeft) {
+			if (SpoP == SpoOwner && SpoP->Next) { SpoP = SpoP->Next; }
+			SpoOwner = 0; 
+		}
+		else {
+			SpoLeft -= Ticks - start; 
+		}
+	}
+}
+#endif
+ 
 /* Actually start the OS */
 void OS_Start(void) {
-	int ppp_next;   /* Queue index of the next periodic process. */ 
 	process *p; 	
-	time_t t;       /* Time to interrupt. */ 
+	tick_t t;       /* Time to interrupt, in ticks. */ 
+	time_t next;    /* When the next task or software timer is due, in ms. */ 
+	tick_t late;    /* How late a device release is, in ticks. */ 
 	
 	IVSWI = SwitchToProcess; 
-	ppp_next = 0; 
+
+	ClockUpdate(); 
+#ifndef FIXED_PRIORITY
+	SlotStart(); 
+#endif
 
 	/* Scheduler. */ 
 	while (1) {
@@ -106,83 +385,78 @@ void OS_Start(void) {
 	
 		PCurrent = 0;
 		p = 0; 
-		t = 0;  
+		/* Everything made ready so far is seen by this pass. */ 
+		Woken = FALSE; 
+
+		/* 
+		   t starts as far ahead as OC4 allows, and every event below only 
+		   brings it forward; there is no "nothing due" value. Processes 
+		   made ready, and anything new, bring the preemption forward with 
+		   PreemptAt(). 
+		*/ 
+		t = Ticks + MAX_PREEMPTION_TICKS; 
+
+		/* Run stackless tasks that are due, and bring t forward to when the next one is. */ 
+		if (RunTasks(&next) && TICKS_BEFORE(MS_TO_TICKS(next), t)) { t = MS_TO_TICKS(next); }
+
+		/* Call back expired software timers, and bring t forward to the next expiry. */ 
+		if (RunTimers(&next) && TICKS_BEFORE(MS_TO_TICKS(next), t)) { t = MS_TO_TICKS(next); }
 
 		if (DevP) {
 			p = DevP; 
-			/* Search for a Device process ready to run. */ 
+			/* 
+			   Search for a Device process ready to run. If several are, take 
+			   the one with the shortest period (rate monotonic), so a fast 
+			   driver never queues behind a slow one. 
+			*/ 
 			do { 
-				if (p->DevNextRunTime <= Clock) {
+				if (!TICKS_BEFORE(Ticks, p->DevNextRunTime) 
+				    && (!PCurrent || p->DevPeriod < PCurrent->DevPeriod)) {
 					PCurrent = p;
-					break; 
 				}
 			} while ((p = p->Next) && (p != DevP)); 
 
 			/* If a device process is ready, run it. */ 
 			if (PCurrent) {	
-				/* Update the next time for the device process to run. */
-				if (PCurrent->state == NEW) {
-					PCurrent->DevNextRunTime = Clock + (time_t)(PCurrent->Name);
-				} 
-				else {
-					PCurrent->DevNextRunTime += (time_t)(PCurrent->Name);
+				/* Keep the worst release lateness seen, for OS_DeviceLateness(). */ 
+				late = Ticks - PCurrent->DevNextRunTime; 
+				if (late > 0xFFFF) { late = 0xFFFF; }
+				if ((unsigned int)late > PSTATS(PCurrent).DevMaxLate) {
+					PSTATS(PCurrent).DevMaxLate = (unsigned int)late; 
 				}
+
+				/* Update the next time for the device process to run. Releases stay on the grid set by the first one. */
+				PCurrent->DevNextRunTime += PCurrent->DevPeriod;
 			
 				ContextSwitchToProcess(); 					
 				continue; 
 			}			
-			/* Find the time of the next device process, t. */ 
+			/* Find the time of the next device process, task or timer, t. */ 
 			else {
 				p = DevP; 
-				t = p->DevNextRunTime; 
-				while ((p = p->Next) && (p != DevP)) { 
-					if (p->DevNextRunTime < t) {
+				do { 
+					if (TICKS_BEFORE(p->DevNextRunTime, t)) {
 						t = p->DevNextRunTime; 
 					}
-				} 
+				} while ((p = p->Next) && (p != DevP)); 
 			}
 		}
 
-		/* No device processes to run *now*, so try for a periodic process. */ 
-		if (PPPLen) {
-			/* Determine the maximum time to allot the next periodic process, t. */ 
-			if (!t || ((Clock + PPPMax[ppp_next]) <  t)) {
-				t = Clock + PPPMax[ppp_next]; 
-			}
-
-			/* If the current next process isn't idle, try to look it up. */ 
-			if (PPP[ppp_next] != IDLE) {
-				PCurrent = GetPeriodicProcessByName(PPP[ppp_next]); 	
-			}
-
-			circularIncrement(&ppp_next, PPPLen); 
-
-			/* If a periodic process is ready to run, run it. */ 
-			if (PCurrent) {
-				SetPreemptionTime(t);
-				ContextSwitchToProcess();
-				ClockUpdate();
-				/* If we used up our time slice, continue to the next process. */ 
-				if (t < Clock) { continue; }
-				/* Otherwise fall through to schedule a sporadic process or idle time. */ 
-				else           { PCurrent = 0; }
-			}
-		}
-	
-		/* If we don't yet know when we have to come back, use MAX_EXECUTION_TIME. */ 
-		if (!t) { t = MAX_EXECUTION_TIME; }
-	
-		/* We're here so we must be idle. Schedule a sporadic process. */ 
-		if (SpoP) { 
-			PCurrent = SpoP; 
-		} 
-		/* We're here so we must be idle and there must be no sporadic processes to run. */ 
-		else {
+#ifdef FIXED_PRIORITY
+		/* 
+		   Fixed priorities: PPP[] is ignored, and the highest priority 
+		   ready process runs until the next device release, task or timer, 
+		   or until a wakeup of a higher priority process preempts it. 
+		*/ 
+		if (!(PCurrent = HighestReady())) {
 			PCurrent = &IdleProcess; 
 		}
-		SetPreemptionTime(t);	
+		SetPreemptionTicks(t); 
 		ContextSwitchToProcess(); 
-		continue;
+		continue; 
+#else
+		ScheduleSlot(t); 
+#endif
 	} 
 }
  
@@ -214,22 +488,233 @@ PID OS_Create(void (*f)(void), int arg, unsigned int level, unsigned int n) {
 
 	p->Name  = n; 
 	p->Level = level;
+	/* Fixed priority builds take the priority from the name; out of range is lowest. */ 
+	p->Prio  = (n < MAXPRIO) ? n : MAXPRIO-1; 
 	p->Arg   = arg;
 	p->state = NEW; 	
 	p->Next  = 0;
 	p->Prev  = 0;  
-	p->DevNextRunTime   = 0; 
+	/* Initial stack pointer points at the end of the stack. */ 
+	p->SP    = &(Stacks[i][WORKSPACE-1]); 
+	/* A DEVICE process is first released straight away. */ 
+	p->DevNextRunTime   = Ticks; 
+	p->DevPeriod        = MS_TO_TICKS(n); 
+	PSTATS(p).DevMaxLate       = 0; 
+	PSTATS(p).DeadlineState    = DEADLINE_NONE; 
+	PSTATS(p).DeadlineMisses   = 0; 
 	p->program_location = f;
 
 	AddToSchedulingQueue(p); 
 
+	/* A new device process is due now; don't leave it waiting for the running process's slot to end. */ 
+	if (level == DEVICE) { PreemptAt(Clock); }
+
 	if (!I) { OS_EI(); }
 	return p->pid; 
 }
+
+PID OS_CreateDevice(void (*f)(void), int arg, tick_t period, tick_t offset) {
+	PID pid; 
+	BOOL I; 
+
+	I = CheckInterruptMask(); 
+	OS_DI(); 
+
+	/* Name holds the rate in ms for DEVICE processes; keep it as close as it can be. */ 
+	pid = OS_Create(f, arg, DEVICE, (unsigned int)(period / TIME_QUANTUM)); 
+	if (pid != INVALIDPID) {
+		P[pid-1].DevPeriod       = period ? period : 1; 
+		P[pid-1].DevNextRunTime += offset; 
+	}
+
+	if (!I) { OS_EI(); }
+	return pid; 
+}
+
+unsigned int OS_DeviceLateness(PID pid) {
+	unsigned int late; 
+	BOOL I; 
+
+	if (pid == INVALIDPID || pid > MAXPROCESS) { return 0; }
+
+	I = CheckInterruptMask(); 
+	OS_DI(); 
+	late = PStats[pid-1].DevMaxLate; 
+	PStats[pid-1].DevMaxLate = 0; 
+	if (!I) { OS_EI(); }
+	return late; 
+}
+
+void OS_SetQuantum(unsigned int ms) {
+	SporadicQuantum = MS_TO_TICKS(ms); 
+}
+
+void OS_SetEDF(BOOL on) {
+	SporadicEDF = on; 
+}
+
+void OS_SetDeadline(unsigned int ms) {
+	BOOL I; 
+
+	I = CheckInterruptMask(); 
+	OS_DI(); 
+
+	/* The previous deadline is complete; count it if it was missed and the kernel hasn't yet. */ 
+	if (PSTATS(PCurrent).DeadlineState == DEADLINE_PENDING && TICKS_BEFORE(PSTATS(PCurrent).Deadline, TicksNow())) {
+		PSTATS(PCurrent).DeadlineMisses++; 
+	}
+
+	if (ms) {
+		PSTATS(PCurrent).Deadline      = TicksNow() + MS_TO_TICKS(ms); 
+		PSTATS(PCurrent).DeadlineState = DEADLINE_PENDING; 
+	}
+	else {
+		PSTATS(PCurrent).DeadlineState = DEADLINE_NONE; 
+	}
+
+	/* Another process may now have the earliest deadline. */ 
+	if (SporadicEDF && PCurrent->Level == SPORADIC) {
+		ContextSwitchToKernel(); 
+	}
+
+	if (!I) { OS_EI(); }
+}
+
+unsigned int OS_DeadlineMisses(PID pid) {
+	unsigned int misses; 
+	BOOL I; 
+
+	if (pid == INVALIDPID || pid > MAXPROCESS) { return 0; }
+
+	I = CheckInterruptMask(); 
+	OS_DI(); 
+	misses = PStats[pid-1].DeadlineMisses; 
+	if (!I) { OS_EI(); }
+	return misses; 
+}
+
+BOOL OS_SetPlan(int *ppp, int *max, int len) {
+	int i; 
+	BOOL I; 
+
+	if (len < 0 || len > MAXPROCESS) { return FALSE; }
+	/* Every slot must have some length, or the cycle could never move on. */ 
+	for (i = 0; i < len; i++) {
+		if (max[i] <= 0) { return FALSE; }
+	}
+
+	I = CheckInterruptMask(); 
+	OS_DI(); 
+
+	/* Replaces any plan staged earlier that has not yet taken over. */ 
+	for (i = 0; i < len; i++) {
+		PlanPPP[i] = ppp[i]; 
+		PlanMax[i] = max[i]; 
+	}
+	PlanLen     = len; 
+	PlanPending = TRUE; 
+
+	if (!I) { OS_EI(); }
+	return TRUE; 
+}
+
+void OS_SetAutoTune(BOOL on) {
+	int i; 
+	BOOL I; 
+
+	I = CheckInterruptMask(); 
+	OS_DI(); 
+	PPPAutoTune = on; 
+	/* Without auto-tune every entry has its whole slot again. */ 
+	if (!on) {
+		for (i = 0; i < MAXPROCESS; i++) { PPPStats[i].Budget = 0; }
+	}
+	if (!I) { OS_EI(); }
+}
+
+BOOL OS_SlotStats(int i, slot_stats *s) {
+	BOOL I; 
+
+	if (i < 0 || i >= PPPLen) { return FALSE; }
+
+	I = CheckInterruptMask(); 
+	OS_DI(); 
+	*s = PPPStats[i]; 
+	if (!I) { OS_EI(); }
+	return TRUE; 
+}
+
+void OS_SetServer(unsigned int budget, unsigned int period) {
+	BOOL I; 
+
+	I = CheckInterruptMask(); 
+	OS_DI(); 
+	ServerBudget    = MS_TO_TICKS(budget); 
+	ServerPeriod    = MS_TO_TICKS(period ? period : 1); 
+	ServerLeft      = ServerBudget; 
+	ServerReplenish = TicksNow() + ServerPeriod; 
+	if (!I) { OS_EI(); }
+}
+
+/* Greatest common divisor of two periods. */ 
+static tick_t PeriodGCD(tick_t a, tick_t b) {
+	tick_t r; 
+
+	while (b) {
+		r = a % b; 
+		a = b; 
+		b = r; 
+	}
+	return a; 
+}
+
+tick_t OS_DeviceStagger(tick_t period) {
+	process *p; 
+	tick_t offset, best_offset; 
+	tick_t g, sep, worst, best; 
+	long phase; 
+	int i; 
+	BOOL I; 
+
+	if (!period) { return 0; }
+
+	I = CheckInterruptMask(); 
+	OS_DI(); 
+
+	best_offset = 0; 
+	best        = 0; 
+	for (i = 0; i < DEVICE_STAGGER_STEPS; i++) {
+		offset = (period * i) / DEVICE_STAGGER_STEPS; 
+
+		/* 
+		   Two release grids with periods a and b come closest where their 
+		   phase difference, taken modulo gcd(a, b), is nearest 0. 
+		*/ 
+		worst = period; 
+		if ((p = DevP)) {
+			do {
+				g     = PeriodGCD(period, p->DevPeriod); 
+				phase = (long)(Ticks + offset - p->DevNextRunTime) % (long)g; 
+				if (phase < 0) { phase += g; }
+				sep   = ((tick_t)phase < g - phase) ? (tick_t)phase : g - phase; 
+				if (sep < worst) { worst = sep; }
+			} while ((p = p->Next) && (p != DevP)); 
+		}
+
+		if (worst > best) {
+			best        = worst; 
+			best_offset = offset; 
+		}
+	}
+
+	if (!I) { OS_EI(); }
+	return best_offset; 
+}
  
 void OS_Terminate() {
 	OS_DI(); 
 	PCurrent->pid = INVALIDPID;
+	Yielded = TRUE; 
 
 	RemoveFromSchedulingQueue(PCurrent); 
 	
@@ -238,10 +723,20 @@ void OS_Terminate() {
 } 
 
 void OS_Yield() {
-	/* Move sporatic process to the end of the Queue */ 
-	if ((PCurrent->Level == SPORADIC) && SpoP && SpoP->Next) { 
+#ifdef FIXED_PRIORITY
+	/* Let the next process of the same priority have a turn. */ 
+	if ((PCurrent->Level != DEVICE) && (PCurrent != &IdleProcess) 
+	    && (PrioQ[PCurrent->Prio] == PCurrent) && PCurrent->Next) {
+			PrioQ[PCurrent->Prio] = PCurrent->Next; 
+	}
+#else
+	/* Move sporatic process to the end of the Queue, if it is still at the head (not blocked). */ 
+	if ((PCurrent->Level == SPORADIC) && (SpoP == PCurrent) && SpoP->Next) { 
 			SpoP = SpoP->Next; 
 	} 
+#endif
+	/* Tells the scheduler a periodic process gave up its slot, rather than being preempted. */ 
+	Yielded = TRUE; 
 	ContextSwitchToKernel(); 
 }
 
@@ -82,6 +82,9 @@
 
 
 /* Timing */ 
+#define M6811_CFORC	0x0B    /* FOC1:FOC2:FOC3:FOC4:FOC5:0:0:0 */
+#define M6811_OC1M	0x0C    /* OC1M7:OC1M6:OC1M5:OC1M4:OC1M3:0:0:0 - Pins driven by OC1 */
+#define M6811_OC1D	0x0D    /* OC1D7:OC1D6:OC1D5:OC1D4:OC1D3:0:0:0 - Levels OC1 drives */
 #define M6811_TCNT_HIGH	0x0E	/* Timer Counter - Read in one instruction. */ 
 #define M6811_TCNT_LOW	0x0F
 /* Input Capture Registers */ 
@@ -113,6 +116,7 @@
 #define M6811_TMSK2	0x24    /* TOI:RTII:PAOVI:PAII:0:0:PR1:PR0 */
 #define M6811_TFLG2	0x25    /* TOF:RTIF:PAOVF:PAIF:0:0:0:0 */ 
 #define M6811_PACTL	0x26    /* DDRA7:PAEN:PAMOD:PEDGE:0:0:RTR1:RTR0 */ 
+#define M6811_PACNT	0x27    /* Pulse accumulator count */ 
 /*
 TOI: Enable interrupt on overflow. 
 TOF: Overflow has occurred.  	
@@ -11,20 +11,63 @@
 int PPPLen;
 int PPP[MAXPROCESS]; 
 int PPPMax[MAXPROCESS];
+BOOL PPPMaxTicks;
+BOOL PPPAutoTune;
+slot_stats PPPStats[MAXPROCESS];
 
 process P[MAXPROCESS]; /* Main process table.        */ 
+proc_stats PStats[MAXPROCESS]; /* Cold half of each PCB.   */ 
+
+/* The PCB must stay 32 bytes on the target (16 bit int and pointers), or indexing P[] needs a multiply. */ 
+typedef char process_size_check[(sizeof(int) != 2 || sizeof(process) == 32) ? 1 : -1]; 
+
+/* Process stacks go in the reserved stacks region when they fit beside IStack, otherwise with the rest of the data. */ 
+#if (MAXPROCESS * WORKSPACE) <= (STACKS_REGION_SIZE - ISTACK_SIZE)
+char Stacks[MAXPROCESS][WORKSPACE] __attribute__((section(".stacks")));
+#else
+char Stacks[MAXPROCESS][WORKSPACE];
+#endif
+char IdleStack[WORKSPACE];        /* Stack of IdleProcess.      */ 
 process *PCurrent;     /* Currently running process. */ 
 process *DevP;         /* Device Process Queue       */ 
 process *SpoP;         /* Sproatic Process Queue     */
+volatile BOOL Woken;   /* Process made ready since the last schedule. */ 
+BOOL Yielded;          /* Running process gave up the CPU itself. */ 
+tick_t SporadicQuantum; /* Round robin time slice of SPORADIC processes, 0 for none. */ 
+#ifdef FIXED_PRIORITY
+unsigned int PrioBitmap;  /* Bit i set while PrioQ[i] is not empty. */ 
+process *PrioQ[MAXPRIO];  /* Ready queue of each priority.           */ 
+#endif
+BOOL SporadicEDF;       /* SPORADIC processes run earliest deadline first. */ 
+
+tick_t ServerBudget;    /* Sporadic server capacity per period.  */ 
+tick_t ServerPeriod;    /* Sporadic server replenishment period. */ 
+tick_t ServerLeft;      /* Capacity left this period.            */ 
+tick_t ServerReplenish; /* When ServerLeft is next refilled.     */ 
 
 process IdleProcess; 
 kernel  PKernel;
 
 time_t Clock;       /* Time since system start in ms. */ 
+volatile tick_t Ticks; /* Time since system start in timer ticks. */ 
+tick_t PreemptionTicks; /* Last time OC4 was set for. */ 
 
 void UnhandledInterrupt (void) { return; }  
 
-void Idle (void) { while (1); }
+void Idle (void) { 
+	while (1) {
+		/* Mask interrupts for the check, so a wakeup can't slip in just before we sleep. */ 
+		OS_DI(); 
+		/* An interrupt handler has made a process ready; let the scheduler decide whether it runs now. */ 
+		if (Woken) { 
+			OS_Yield(); 
+		}
+		/* Sleep until the next interrupt, with the registers already stacked. */ 
+		else { 
+			asm volatile (" cli \n\t wai "); 
+		}
+	}
+}
 
 void circularIncrement(int *i, int max) { *i = (++(*i) >= max)?0:*i; }
 
@@ -36,24 +79,75 @@ void ContextSwitchToKernel(void)  { asm volatile (" swi "); }
 void ContextSwitchToProcess(void) { asm volatile (" swi "); }
 
 void SetPreemptionTime(time_t time) {
-	SetPreemptionTimerInterval((unsigned int)(time - Clock)); 
+	/* Ticks and Clock count from the same instant, so ms times land on tick times exactly. */ 
+	SetPreemptionTicks(MS_TO_TICKS(time)); 
 }
 
 void SetPreemptionTimerInterval(unsigned int miliseconds) {
-	unsigned int *TOC4_address; 
-	unsigned int *timer_address; 
+	SetPreemptionTicks(TicksNow() + MS_TO_TICKS(miliseconds)); 
+}
 
-	/* Make sure these are read as signel 16 bit numbers. */ 
-	TOC4_address  = (unsigned int*)&(Ports[M6811_TOC4_HIGH]);
-	timer_address = (unsigned int*)&(Ports[M6811_TCNT_HIGH]);
-	
-	/* Read the tick register, add a time to it, and store it in the OC4 compare register. */ 
-	*TOC4_address = (*timer_address + (miliseconds * TIME_QUANTUM)); 
+void PreemptAt(time_t time) {
+	/* OC4 is only enabled while a SPORADIC, PERIODIC or idle process runs. */ 
+	if ((Ports[M6811_TMSK1] & M6811_BIT4) && TICKS_BEFORE(MS_TO_TICKS(time), PreemptionTicks)) {
+		/* Clock only moves in the kernel; bring it up to date before using it. */ 
+		ClockUpdate(); 
+		SetPreemptionTicks(MS_TO_TICKS(time)); 
+	}
+}
+
+tick_t TicksNow(void) {
+	/* The low 16 bits of Ticks are TCNT at the last update; add what TCNT has counted since. */ 
+	return Ticks + (unsigned int)(*(unsigned int *)&(Ports[M6811_TCNT_HIGH]) - (unsigned int)Ticks); 
+}
+
+void SetPreemptionTicks(tick_t time) {
+	volatile unsigned int *timer_address; 
+	unsigned int *TOC4_address; 
+	unsigned int timer_value; 
+	unsigned int compare; 
+	tick_t now; 
+
+	timer_address = (unsigned int*)&(Ports[M6811_TCNT_HIGH]); 
+	TOC4_address  = (unsigned int*)&(Ports[M6811_TOC4_HIGH]); 
+
+	/* Clear OC4F first, so a match of the old compare can't be taken for the new one. Flags clear on writing a one, and a read-modify-write would clear OC5F too. */  
+	Ports[M6811_TFLG1] = M6811_BIT4;
+
+	now = TicksNow(); 
+	if ((long)(time - now) > (long)MAX_PREEMPTION_TICKS) { time = now + MAX_PREEMPTION_TICKS; }
+	if ((long)(time - now) < MIN_PREEMPTION_TICKS)       { time = now + MIN_PREEMPTION_TICKS; }
+
+	/* 
+	   The low 16 bits of a tick time are the compare value. TCNT is read 
+	   again right before the write, so only a few instructions separate 
+	   them; a compare that has fallen behind it, or within 
+	   MIN_PREEMPTION_TICKS, is moved just ahead of it. 
+	*/ 
+	compare     = (unsigned int)time; 
+	timer_value = *timer_address; 
+	if ((unsigned int)(compare - timer_value) < MIN_PREEMPTION_TICKS 
+	    || (unsigned int)(compare - timer_value) > MAX_PREEMPTION_TICKS) {
+		compare = timer_value + MIN_PREEMPTION_TICKS; 
+	}
+	*TOC4_address = compare; 
+
+	/* 
+	   TCNT already past the compare with no match means the write came too 
+	   late, and OC4 would not fire until TCNT came all the way around. 
+	   TCNT is read before the flag, so a match in between is not mistaken 
+	   for a miss. 
+	*/ 
+	while ((unsigned int)(*timer_address - timer_value) >= (unsigned int)(compare - timer_value) 
+	       && !(Ports[M6811_TFLG1] & M6811_BIT4)) {
+		timer_value   = *timer_address; 
+		compare       = timer_value + MIN_PREEMPTION_TICKS; 
+		*TOC4_address = compare; 
+	}
+	PreemptionTicks = now + (unsigned int)(compare - (unsigned int)now); 
 	
 	/* Set OL4 */ 
 	//Ports[M6811_TCTL1] SET_BIT(M6811_BIT2);
-	/* Set OC4F */  
-	Ports[M6811_TFLG1] SET_BIT(M6811_BIT4);
 	/* Unmask OC4 interrupt */
 	Ports[M6811_TMSK1] SET_BIT(M6811_BIT4);
 }
@@ -71,6 +165,7 @@ void ClockUpdateHandler (void) {
 */ 
 void ClockUpdate(void) {
 	unsigned int elapsed_time; 
+	unsigned int elapsed_ms; 
 	unsigned int timer_value; 
 	volatile unsigned int *timer_address; 
 	static unsigned int residual = 0; 
@@ -80,31 +175,39 @@ void ClockUpdate(void) {
 	timer_address = (unsigned int *)&Ports[M6811_TCNT_HIGH];
 	timer_value = *timer_address;
 
-	/* Check for TOF flag indicating an overflow condition. */ 
+	/* 
+	   16 bit subtraction gives the ticks elapsed across at most one overflow, 
+	   so TOF only needs clearing. Clear it by writing a one; a 
+	   read-modify-write would also clear PAOVF. 
+	*/ 
+	elapsed_time = timer_value - last_timer_value;
 	if (Ports[M6811_TFLG2] & M6811_BIT7) {
-		elapsed_time = (0xFFFF - last_timer_value) + timer_value; 
-		Ports[M6811_TFLG2] CLR_BIT(M6811_BIT7);
-	}
-		else {
-		elapsed_time = timer_value - last_timer_value;
+		Ports[M6811_TFLG2] = M6811_BIT7;
 	}
 
-	/* Add on the residual from the last update. */ 
-	elapsed_time += residual; 
-
-	residual = elapsed_time % TIME_QUANTUM; 
+	Ticks += elapsed_time; 
+
+	/* 
+	   Everything stays 16 bit, so quotient and remainder come from a 
+	   single IDIV rather than the 32 bit helpers: whole ms of this update, 
+	   then the residual carried from the last one. 
+	*/ 
+	elapsed_ms    = elapsed_time / TIME_QUANTUM; 
+	residual     += elapsed_time % TIME_QUANTUM; 
+	if (residual >= TIME_QUANTUM) {
+		residual -= TIME_QUANTUM; 
+		elapsed_ms++; 
+	}
 
-	Clock += (elapsed_time-residual)/TIME_QUANTUM;
+	Clock += elapsed_ms;
 
 	/* Account for the residual during the next update. */ 
 	last_timer_value = timer_value; 
 }
 
 process *GetPeriodicProcessByName(unsigned int n) {
-        int i; 
         process *p; 
-        for (i = 0; i < MAXPROCESS; i++) {
-		p = &P[i]; 
+        for (p = P; p < &P[MAXPROCESS]; p++) {
 		if (
 			   (p->pid != INVALIDPID) 
 			&& (p->Level == PERIODIC) 
@@ -117,7 +220,36 @@ process *GetPeriodicProcessByName(unsigned int n) {
         return 0; 
 }
 
+#ifdef FIXED_PRIORITY
+/* Lowest set bit of a nibble, 4 for none. */ 
+static const unsigned char FirstBit[16] = { 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0 }; 
+
+process *HighestReady(void) {
+	unsigned int b = PrioBitmap; 
+	int i = 0; 
+
+	if (!b) { return 0; }
+
+	/* Halve the search twice, then look the bit up: the same few steps for any bitmap. */ 
+	if (!(b & 0x00FF)) { b >>= 8; i  = 8; }
+	if (!(b & 0x000F)) { b >>= 4; i += 4; }
+	return PrioQ[i + FirstBit[b & 0x000F]]; 
+}
+#endif
+
 void AddToSchedulingQueue(process *p) {
+	/* Idle() gives the CPU back as soon as it sees this. */ 
+	Woken = TRUE; 
+#ifdef FIXED_PRIORITY
+	/* Every process but a device goes in the queue for its priority. */ 
+	if (p->Level != DEVICE) {
+		PrioQ[p->Prio] = QueueAdd(p, PrioQ[p->Prio]); 
+		PrioBitmap    |= (1U << p->Prio); 
+		/* Preemption on wakeup: a process above the running one takes over straight away. */ 
+		if (PCurrent && p->Prio < PCurrent->Prio) { PreemptAt(Clock); }
+		return; 
+	}
+#endif
         /* Add Sporatic Processes to the Sporatic Queue */ 
         if (p->Level == SPORADIC) { 
 			SpoP = QueueAdd(p, SpoP); 
@@ -125,10 +257,26 @@ void AddToSchedulingQueue(process *p) {
         /* Add Device Processes to the Device Queue */ 
         if (p->Level == DEVICE)   { 
 			DevP = QueueAdd(p, DevP); 
+			/* 
+			   A device that blocked past its release would otherwise count 
+			   the whole block as release lateness; its release is now. 
+			*/ 
+			if (p->state == READY && TICKS_BEFORE(p->DevNextRunTime, TicksNow())) {
+				p->DevNextRunTime = TicksNow(); 
+			}
+			/* A woken device may be due already; have the scheduler look now, not at the running process's OC4. */ 
+			if (PCurrent && PCurrent->Level != DEVICE) { PreemptAt(Clock); }
 		}
 }
 
 void RemoveFromSchedulingQueue(process *p) {
+#ifdef FIXED_PRIORITY
+	if (p->Level != DEVICE) {
+		PrioQ[p->Prio] = QueueRemove(p, PrioQ[p->Prio]); 
+		if (!PrioQ[p->Prio]) { PrioBitmap &= ~(1U << p->Prio); }
+		return; 
+	}
+#endif
         /* Remove the process from the SPORATIC queue */
         if (p->Level == SPORADIC) { 	
 			SpoP = QueueRemove(p, SpoP);
@@ -209,7 +357,7 @@ void ReturnToKernel(void)  {
 	PCurrent->SP++;
 
 	/* Clear OC4 Flag */  
-	Ports[M6811_TFLG1] CLR_BIT(M6811_BIT4);
+	Ports[M6811_TFLG1] = M6811_BIT4;
 	/* Mask OC4 interrupts */
 	Ports[M6811_TMSK1] CLR_BIT(M6811_BIT4);
 	
@@ -246,7 +394,7 @@ void SwitchToProcess(void) {
 		/* Set the process to the ready state. */
 		PCurrent->state = READY; 
 		/* Load Process Stack Pointer */ 
-		asm volatile (" lds %0 " : : "m" (PCurrent->ISP) : "memory"); 
+		asm volatile (" lds %0 " : : "m" (PCurrent->SP) : "memory"); 
 		/* Run process for the first time. */
 		OS_EI();
 		PCurrent->program_location();
@@ -12,11 +12,59 @@
 #include "ports.h"
 #include "interrupts.h"
 
+/* 
+   os.h is the fixed interface and is not edited per build. A build may 
+   still size the process table and the process stacks by defining 
+   OS_MAXPROCESS and OS_WORKSPACE. 
+*/ 
+#ifdef OS_MAXPROCESS
+#undef MAXPROCESS
+#define MAXPROCESS OS_MAXPROCESS
+#endif
+#ifdef OS_WORKSPACE
+#undef WORKSPACE
+#define WORKSPACE OS_WORKSPACE
+#endif
+
 #define M6811_CPU_KHZ 2000
 #define TIME_QUANTUM (M6811_CPU_KHZ/16)
 
-/* Maximum time any sporadic or idle process can execute in ms. */ 
-#define MAX_EXECUTION_TIME 10
+/* Size of the reserved "stacks" region in memory.x. */ 
+#define STACKS_REGION_SIZE 0x1000
+
+/* Size of the interrupt stack (isr.h), carved from the stacks region. */ 
+#define ISTACK_SIZE 256
+
+/* 
+   Longest OC4 can be set ahead, in ms. Must stay below one TCNT overflow 
+   (524 ms), both for the compare and so ClockUpdate() sees every overflow. 
+*/ 
+#define MAX_PREEMPTION_TIME 500
+#define MAX_PREEMPTION_TICKS ((tick_t)MAX_PREEMPTION_TIME * TIME_QUANTUM)
+
+/* 
+   Fewest ticks OC4 is set ahead of TCNT, so the compare can't be written 
+   after it has passed: 128 us, well over the few instructions between 
+   reading TCNT and writing TOC4 in SetPreemptionTicks(). 
+*/ 
+#define MIN_PREEMPTION_TICKS 16
+
+/* Default time a SPORADIC process runs before the next one gets a turn, in ms. */ 
+#define SPORADIC_QUANTUM 10
+
+/* 
+   Priorities for FIXED_PRIORITY builds, 0 (highest) to MAXPRIO-1. At most 
+   16, one per bit of PrioBitmap. 
+*/ 
+#define MAXPRIO 16
+
+/* Name reserved in PPP[] for slots kept for SPORADIC work; scheduled like IDLE ones. */ 
+#define SERVER -2
+
+/* Deadline states of a SPORADIC process. */ 
+#define DEADLINE_NONE    0
+#define DEADLINE_PENDING 1
+#define DEADLINE_MISSED  2
 
 #define NEW 0
 #define READY 1
@@ -24,36 +72,106 @@
 
 typedef volatile long time_t; 
 
+/* 
+   Time in timer ticks (8 usec). The low 16 bits of the tick clock are 
+   TCNT, so a tick time is also the value to load in an output compare. 
+   Tick times wrap after about 9 hours; compare them with TICKS_BEFORE(). 
+*/ 
+typedef unsigned long tick_t; 
+
+#define MS_TO_TICKS(ms)    ((tick_t)(ms) * TIME_QUANTUM)
+#define US_TO_TICKS(us)    ((tick_t)(us) / (1000 / TIME_QUANTUM))
+
+/* Non-zero if tick time a comes before b. */ 
+#define TICKS_BEFORE(a, b) ((long)((a) - (b)) < 0)
+
+/* 
+   Process control block. Only what the scheduler touches on every pass is 
+   kept here, in byte fields where they fit, and it is padded to 32 bytes 
+   so indexing P[] is a shift. The stacks live in Stacks[], and deadlines 
+   and statistics in PStats[]. 
+*/ 
 typedef struct proc_struct {
-	PID pid;  	               /* Process ID. */ 
-	unsigned int Name;             /* Name of process */ 
-	unsigned int Level;            /* Scheduling level/queue */ 
+	unsigned char pid;             /* Process ID, index in P[] + 1. */ 
+	unsigned char Level;           /* Scheduling level/queue */ 
+	unsigned char state;           /* NEW, READY, WAITING. */  
+	unsigned char Prio;            /* Priority in FIXED_PRIORITY builds, 0 highest. */ 
+	unsigned int Name;             /* Name of process, or rate of a DEVICE process */ 
 	int   Arg;                     /* Process argument */ 
-	char Stack[WORKSPACE]; 
-	char *SP;                      /* Last Stack Pointer */ 
-	char *ISP;                     /* Initial Stack Pointer */ 
+	char *SP;                      /* Last Stack Pointer, or Initial Stack Pointer while NEW */ 
 	void(*program_location)(void); /* Pointer to the process, to start it for the first time. */ 
 
-	int state;                     /* NEW, READY, WAITING. */  
-
 	struct proc_struct* Prev;      /* Pointer to the previous process of this process's queue. */ 
 	struct proc_struct* Next;      /* Pointer to the next process of the queue. */ 
 	
-	time_t DevNextRunTime; 	       /* Device process: run next at this time. */ 
+	tick_t DevNextRunTime; 	       /* Device process: run next at this time, in ticks. */ 
+	tick_t DevPeriod;              /* Device process: release period in ticks. */ 
+
+	unsigned char Pad[8];          /* Rounds the PCB up to 32 bytes. */ 
 } process;
 
+/* Deadlines and statistics of P[i], in PStats[i]; kept out of the PCB. */ 
+typedef struct proc_stats {
+	unsigned int DevMaxLate;       /* Device process: latest release so far, in ticks. */ 
+	unsigned int DeadlineMisses;   /* Sporadic process: deadlines missed so far. */ 
+	tick_t Deadline;               /* Sporadic process: absolute deadline, in ticks. */ 
+	unsigned char DeadlineState;   /* Sporadic process: DEADLINE_NONE, _PENDING or _MISSED. */ 
+} proc_stats; 
+
+/* Entry of PStats[] for process "p" of P[]. */ 
+#define PSTATS(p) (PStats[(p)->pid - 1])
+
+/* Execution record of a PPP[] entry, in ticks. */ 
+typedef struct slot_stats {
+	unsigned int Used;             /* Run so far in the current slot. */ 
+	unsigned int Max;              /* Longest run in any one slot. */ 
+	unsigned int High;             /* Running estimate of the top of the run times. */ 
+	unsigned int Overruns;         /* Slots that ended with the process still running. */ 
+	unsigned int Budget;           /* Auto-tuned run time allowed per slot, 0 for the whole slot. */ 
+	BOOL Overran;                  /* Overran since the last auto-tune. */ 
+} slot_stats; 
+
+/* Margin auto-tune adds to an entry's high run time, on top of a quarter of it, in ticks. */ 
+#define AUTOTUNE_MARGIN (TIME_QUANTUM / 4)
+
 typedef struct kernel_struct {
 	char *SP;                      /* Last Stack Pointer */ 
 } kernel; 
 
 extern time_t Clock;          /* Software clock, registering the number of miliseconds since system startup. */ 
+extern volatile tick_t Ticks; /* The same clock in timer ticks; TCNT extended to 32 bits. */ 
+extern tick_t PreemptionTicks; /* Time OC4 was last set to return to the kernel, in ticks. */ 
+
+extern BOOL PPPMaxTicks;      /* Non-zero if PPPMax[] is given in timer ticks rather than ms. */ 
+extern BOOL PPPAutoTune;      /* Non-zero to auto-tune per slot budgets, see OS_SetAutoTune(). */ 
+extern slot_stats PPPStats[]; /* Execution record of each PPP[] entry. */ 
 
 extern process P[];           /* Main process table.       */ 
+extern char Stacks[][WORKSPACE]; /* Stack of each process in P[]. */ 
+extern proc_stats PStats[];   /* Deadlines and statistics of each process in P[]. */ 
 extern process *PCurrent;     /* Currently running process */ 
 extern process *DevP;         /* Device Process Queue      */ 
 extern process *SpoP;         /* Sproatic Process Queue    */
+extern volatile BOOL Woken;   /* A process was made ready since the scheduler last ran. */ 
+extern BOOL Yielded;          /* The running process gave up the CPU itself, by yielding, blocking or ending. */ 
+extern tick_t SporadicQuantum; /* Round robin time slice of SPORADIC processes, in ticks. */ 
+extern BOOL SporadicEDF;      /* Non-zero to run SPORADIC processes earliest deadline first. */ 
+
+extern tick_t ServerBudget;   /* Sporadic server: capacity per period, in ticks. */ 
+extern tick_t ServerPeriod;   /* Sporadic server: replenishment period, in ticks. */ 
+extern tick_t ServerLeft;     /* Sporadic server: capacity left this period, in ticks. */ 
+extern tick_t ServerReplenish; /* Sporadic server: next replenishment, in ticks. */ 
+
+#ifdef FIXED_PRIORITY
+extern unsigned int PrioBitmap; /* Bit i set while PrioQ[i] holds a ready process. */ 
+extern process *PrioQ[];      /* Ready queue of each priority. */ 
+
+/* The process to run next: the head of the highest non-empty PrioQ[], or 0. Constant time. */ 
+process *HighestReady(void); 
+#endif
 
 extern process IdleProcess;   /* Pseudo-process to run when ther is nothing else to do. */ 
+extern char IdleStack[];      /* Stack of the idle process. */ 
 extern kernel  PKernel;       /* Contains information required to reuturn to kernel mode. */ 
 
 BOOL CheckInterruptMask (); 
@@ -106,11 +224,116 @@ process *QueueAdd(process *p, process *Queue);
 /* Remove process p from Queue and return a pointer to the head of the queue. */ 
 process *QueueRemove(process *p, process *Queue);
 
-/* Set OC4 to interrupt at an absolute time, given in miliseconds. */ 
+/* Set OC4 to interrupt at an absolute time, given in miliseconds, at most MAX_PREEMPTION_TIME ahead. */ 
 void SetPreemptionTime(time_t time);   
 
+/* Set OC4 to interrupt at an absolute time, given in ticks, at most MAX_PREEMPTION_TICKS ahead. */ 
+void SetPreemptionTicks(tick_t time);   
+
+/* Current time in ticks, read from TCNT. Does not update Ticks or Clock. */ 
+tick_t TicksNow(void); 
+
+/* 
+   If a process is running and will be preempted after "time", bring the 
+   preemption forward to "time", so the kernel sees a new event in time. 
+   Interrupts must be masked. Does nothing in the kernel, or while a DEVICE 
+   process runs. 
+*/ 
+void PreemptAt(time_t time); 
+
 /* Set OC4 to interrupt in a given number of miliseconds. */ 
 void SetPreemptionTimerInterval(unsigned int miliseconds); 
 
 
+/* 
+   Create a DEVICE process released every "period" timer ticks (8 usec), 
+   e.g. US_TO_TICKS(200) for 5 kHz, rather than every "n" ms as with 
+   OS_Create(). Releases are programmed directly on OC4, so they keep 
+   tick-accurate spacing. The first release is "offset" ticks from now. 
+   Returns INVALIDPID if no PCB is free. 
+*/ 
+PID OS_CreateDevice(void (*f)(void), int arg, tick_t period, tick_t offset); 
+
+/* 
+   Worst lateness of any release of DEVICE process "pid", in ticks, from 
+   when it was due to when it was switched to, since the last call. Due 
+   devices are run shortest period first, so the fastest should see least. 
+*/ 
+unsigned int OS_DeviceLateness(PID pid); 
+
+/* 
+   Set the SPORADIC round robin quantum to "ms". When a process at the 
+   head of the queue has run that long in idle time without yielding, it 
+   goes to the back. Time taken by DEVICE releases and PERIODIC slots does 
+   not count against it. 0 restores plain first-come-first-served. 
+*/ 
+void OS_SetQuantum(unsigned int ms); 
+
+/* 
+   Switch the SPORADIC queue between first-come-first-served (FALSE, the 
+   default) and earliest deadline first (TRUE). In EDF mode the ready 
+   process with the earliest deadline runs first and is not time sliced; 
+   processes without a deadline share what is left as before. 
+*/ 
+void OS_SetEDF(BOOL on); 
+
+/* 
+   Give the calling SPORADIC process a deadline "ms" from now, or clear it 
+   if "ms" is 0. Setting or clearing a deadline completes the previous 
+   one, which counts as missed if it has passed. In EDF mode the kernel 
+   then picks the next process to run. 
+*/ 
+void OS_SetDeadline(unsigned int ms); 
+
+/* Number of deadlines SPORADIC process "pid" has missed. */ 
+unsigned int OS_DeadlineMisses(PID pid); 
+
+/* 
+   Stage a new PERIODIC plan of "len" entries, copied from "ppp" and "max" 
+   (in the units PPPMaxTicks selects). It replaces PPP[] and PPPMax[] 
+   between two cycles, when the last slot of the current plan ends, and 
+   the new cycle starts on that boundary. DEVICE releases and the 
+   SPORADIC queue are not affected. Returns FALSE, and stages nothing, 
+   if "len" is more than MAXPROCESS or any "max" entry is zero or less. 
+*/ 
+BOOL OS_SetPlan(int *ppp, int *max, int len); 
+
+/* 
+   Turn auto-tuning of PERIODIC budgets on or off. The kernel always 
+   records how long each PPP[] entry's process runs and how often it is 
+   still running when its slot ends (OS_SlotStats()). With auto-tune on, 
+   at each cycle boundary every entry is given a budget of its high run 
+   time plus a quarter, plus AUTOTUNE_MARGIN; a process still running 
+   when that is used up is preempted and the rest of its slot goes to 
+   SPORADIC work. An overrun restores the whole slot for the next cycle. 
+   Slot boundaries, and so PERIODIC timing, never change. 
+*/ 
+void OS_SetAutoTune(BOOL on); 
+
+/* Copy the execution record of PPP[] entry "i" to "s". Returns FALSE if there is no such entry. */ 
+BOOL OS_SlotStats(int i, slot_stats *s); 
+
+/* 
+   Configure the sporadic server. SPORADIC processes always run, uncharged, 
+   in IDLE and SERVER entries and in whatever part of a PERIODIC slot its 
+   process gives up or leaves unused. With a server, pending SPORADIC work 
+   also goes ahead of the PERIODIC process of the current slot, for at most 
+   "budget" ms in every "period" ms; only that stolen time is charged. 
+   Once the budget is spent, PERIODIC processes keep their slots until the 
+   next replenishment, so each loses at most "budget" ms per "period". 
+   Until this is called the budget is 0 and nothing is stolen. 
+*/ 
+void OS_SetServer(unsigned int budget, unsigned int period); 
+
+/* Number of offsets within a period that OS_DeviceStagger() tries. */ 
+#define DEVICE_STAGGER_STEPS 16
+
+/* 
+   Pick a release offset for a new DEVICE process with the given period 
+   that keeps its releases as far as possible from those of the DEVICE 
+   processes already created, for OS_CreateDevice(). Create the fastest 
+   drivers first; each one only avoids those before it. 
+*/ 
+tick_t OS_DeviceStagger(tick_t period); 
+
 #endif /* __process_h__ */
@@ -55,6 +55,7 @@ void OS_Wait(int s) {
 
 void MoveToWaitingQueue(process *p, int s) {
 	p->state = WAITING; 
+	if (p == PCurrent) { Yielded = TRUE; }
 	RemoveFromSchedulingQueue(p); 
 	SemQueues[s] = QueueAdd(p,SemQueues[s]); 
 }
@@ -0,0 +1,64 @@
+/*
+ * task.c
+ * Stackless tasks for small DEVICE drivers.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#include "task.h"
+
+task Tasks[MAXTASK];
+
+int OS_CreateTask(char (*f)(task *), int arg, unsigned int rate) {
+	task *t;
+	int i;
+	int id = INVALIDTASK;
+	BOOL I;
+
+	I = CheckInterruptMask();
+	OS_DI();
+
+	for (i = 0; i < MAXTASK; i++) {
+		t = &Tasks[i];
+		if (!t->Rate) {
+			t->Line        = 0;
+			t->Arg         = arg;
+			t->f           = f;
+			t->NextRunTime = 0;
+			t->Rate        = rate ? rate : 1;
+			id = i;
+			/* It is due at the next scheduling pass. */
+			PreemptAt(Clock);
+			break;
+		}
+	}
+
+	if (!I) { OS_EI(); }
+	return id;
+}
+
+BOOL RunTasks(time_t *next) {
+	task *t;
+	BOOL found = FALSE;
+
+	for (t = Tasks; t < &Tasks[MAXTASK]; t++) {
+		if (!t->Rate) { continue; }
+
+		if (t->NextRunTime <= Clock) {
+			/* Releases stay on the rate grid, except for the first one. */
+			if (!t->NextRunTime) { t->NextRunTime  = Clock + t->Rate; }
+			else                 { t->NextRunTime += t->Rate; }
+
+			OS_EI();
+			if (t->f(t) == TASK_ENDED) { t->Rate = 0; }
+			OS_DI();
+		}
+
+		if (t->Rate && (!found || t->NextRunTime < *next)) {
+			*next = t->NextRunTime;
+			found = TRUE;
+		}
+	}
+	return found;
+}
@@ -0,0 +1,67 @@
+/*
+ * task.h
+ * Stackless tasks for small DEVICE drivers. A task is a function that runs
+ * to completion on the kernel stack each time it is released, and resumes
+ * where it left off through the line number saved in its task block
+ * (protothread style). Tasks are released at a fixed rate by OS_Start(),
+ * ahead of DEVICE processes, and need no PCB, stack or context switch.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#ifndef __TASK_H__
+#define __TASK_H__
+
+#include "os.h"
+#include "process.h"
+
+#define MAXTASK           16     /* max. # of tasks supported */
+#define INVALIDTASK       -1     /* an invalid task descriptor */
+
+  /* Values returned by a task body; only the macros below should produce them. */
+#define TASK_WAITING      0      /* blocked in TASK_WAIT_UNTIL()       */
+#define TASK_YIELDED      1      /* gave up the CPU in TASK_YIELD()    */
+#define TASK_ENDED        2      /* finished, the task is removed      */
+
+typedef struct task_struct {
+	unsigned int Line;                 /* Where to resume, 0 to start over.     */
+	unsigned int Rate;                 /* Release period in ms, 0 if unused.    */
+	int Arg;                           /* Task argument.                        */
+	char (*f)(struct task_struct *);   /* Task body.                            */
+	time_t NextRunTime;                /* Run next at this time.                */
+} task;
+
+/*
+   Task body macros. Locals of a task body do not survive TASK_YIELD() or
+   TASK_WAIT_UNTIL(); keep state in statics or behind t->Arg. A body must
+   not call anything that blocks or yields (OS_Wait(), OS_Yield()), and
+   must not use a switch statement around these macros.
+*/
+#define TASK_BEGIN(t)           switch ((t)->Line) { case 0:
+
+/* Give up the CPU until the next release. */
+#define TASK_YIELD(t)           do { (t)->Line = __LINE__; return TASK_YIELDED; \
+                                     case __LINE__: ; } while (0)
+
+/* Return at each release until "c" holds, then carry on. */
+#define TASK_WAIT_UNTIL(t, c)   do { (t)->Line = __LINE__; \
+                                     case __LINE__: if (!(c)) { return TASK_WAITING; } } while (0)
+
+#define TASK_END(t)             } (t)->Line = 0; return TASK_ENDED
+
+/*
+   Create a task running "f" every "rate" ms, starting at the next
+   scheduling pass. "arg" is available to the body as t->Arg. Returns the
+   task descriptor, or INVALIDTASK if none is free.
+*/
+int OS_CreateTask(char (*f)(task *), int arg, unsigned int rate);
+
+/*
+   Kernel only: run every task that is due, with interrupts enabled.
+   Stores the earliest time any task is due next in "next" and returns
+   TRUE, or returns FALSE if there are none.
+*/
+BOOL RunTasks(time_t *next);
+
+#endif /* __TASK_H__ */
@@ -10,6 +10,12 @@
 #include "os.h"
 #include "ports.h"
 #include "process.h"
+#include "morse.h"
+#include "motor.h"
+#include "adc.h"
+#include "mic.h"
+#include "filter.h"
+#include "task.h"
 
 void ProcessInit () {
 	PPPLen    = 5;
@@ -34,12 +40,12 @@ void TestMain(void) {
 	lcd  = OS_InitFiFo(); 
 	
 	_sys_init_lcd(); 
+	OS_ADCInit(); 
 	
-	OS_InitSem(S_BUZZ,1);
 	OS_InitSem(S_BUZZ_FIFO,1); 
 	OS_InitSem(S_BUZZ_OUTPUT,1);
-	OS_InitSem(S_PORTE,1);
 	OS_InitSem(S_LCD,1);
+	OS_InitSem(S_LIGHT,0);
 	
 	/* Prints the operating system name and plays SOS though the speaker. */ 
 	OS_Wait(S_BUZZ_OUTPUT); 
@@ -47,47 +53,21 @@ void TestMain(void) {
 	OS_Yield(); 
 	
 	OS_Wait(S_BUZZ_OUTPUT);
-	/* Servers */ 
-	OS_Create(FIFOBuzz, buzz, DEVICE, 800);           /* Beep in morse code, charactars from fifo. */ 
-	OS_Create(ReadLightSensors, buzz, DEVICE, 200);   /* Write values representing the light sensors into the fifo */ 
-	OS_Create(ReadMicrophone,   buzz, DEVICE, 500);   /* Write values representing the sound level into the fifo */ 	
-	OS_Create(ReadBumpers, lcd, DEVICE, 10);          /* Reads bumper values into a FIFO, and moves the robot accordingly. */ 
+	/* Servers, fastest first, each offset so its releases fall between those created before it. */ 
+	OS_CreateDevice(ReadMicrophone,   buzz, MS_TO_TICKS(100), OS_DeviceStagger(MS_TO_TICKS(100)));   /* Write values representing the sound level into the fifo */ 	
+	OS_CreateDevice(ReadLightSensors, buzz, MS_TO_TICKS(200), OS_DeviceStagger(MS_TO_TICKS(200)));   /* Write values representing the light sensors into the fifo */ 
+	OS_CreateDevice(FIFOBuzz,         buzz, MS_TO_TICKS(800), OS_DeviceStagger(MS_TO_TICKS(800)));   /* Beep in morse code, charactars from fifo. */ 
+	OS_CreateTask(ReadBumpers, lcd, 10);              /* Reads bumper values into a FIFO, and moves the robot accordingly. */ 
 	/* Printing is too slow... */ 
 	//OS_Create(PrintBumperValue, lcd, PERIODIC, 40); /* Prints the bumper values to the screen. */ 
 	OS_Signal(S_BUZZ_OUTPUT);
 }
 
 
-/* 
-Device: 
-	Scheduling period = 1/frequency of sound. 
-	Parameter (l) = number of oscillations to produce. 
-*/ 
-void Buzz(void) { 
-	int i,l; 
-	
-	l = OS_GetParam(); 
-	
-	/* 
-		Release the cpu each time the speaker bit is 
-		altered, to allow the device process period to determine the frequency. 
-	*/ 
-	for(i = 0; i < l; i++) {	
-		Ports[M6811_PORTA] SET_BIT(BIT3); 
-		OS_Yield(); 
-		Ports[M6811_PORTA] CLR_BIT(BIT3); 
-		OS_Yield(); 
-	}
-	OS_Signal(S_BUZZ); 
-}
-
-inline void dash() { OS_Wait(S_BUZZ); OS_Create(Buzz, 21,  DEVICE, 11); }
-inline void dot()  { OS_Wait(S_BUZZ); OS_Create(Buzz,  8,  DEVICE, 11); }
 /* Device: > 500ms */ 
 void FIFOBuzz(void) {
 	FIFO f;
 	int fi; 
-	unsigned int i; 
 
 	f = (FIFO)OS_GetParam(); 
 	
@@ -95,52 +75,18 @@ void FIFOBuzz(void) {
 		if(OS_Read(f,&fi)) {
 			/* Fifo for charactar output */
 			OS_Wait(S_BUZZ_OUTPUT); 
-			switch((char)fi) {
-				case 'a': dot(); dash(); break; 
-				case 'b': dash(); dot(); dot(); dot(); break; 
-				case 'c': dash(); dot(); dash(); dot(); break; 
-				case 'd': dash(); dot(); dot(); break;
-				case 'e': dot(); break; 
-				case 'f': dot(); dot(); dash(); dot(); break; 
-				case 'g': dash(); dash(); dot(); break; 
-				case 'h': dot(); dot(); dot(); dot(); break; 
-				case 'i': dot(); dot(); break; 
-				case 'j': dot(); dash(); dash(); dash(); break; 
-				case 'k': dash(); dot(); dash(); break; 
-				case 'l': dot(); dash(); dot(); dot(); break; 
-				case 'm': dash(); dash(); break; 
-				case 'n': dash(); dot(); break; 
-				case 'o': dash(); dash(); dash(); break; 
-				case 'p': dot(); dash(); dash(); dot(); break; 
-				case 'q': dash(); dash(); dot(); dash(); break; 
-				case 'r': dot(); dash(); dot(); break; 
-				case 's': dot(); dot(); dot(); break; 
-				case 't': dash(); break; 
-				case 'u': dot(); dot(); dash(); break; 
-				case 'v': dot(); dot(); dot(); dash(); break; 
-				case 'w': dot(); dash(); dash(); break; 
-				case 'x': dash(); dot(); dot(); dash(); break; 
-				case 'y': dash(); dot(); dash(); dash(); break; 
-				case 'z': dash(); dash(); dot(); dot(); break; 
-				case '1': dot(); dash(); dash(); dash(); dash(); break; 
-				case '2': dot(); dot(); dash(); dash(); dash(); break; 
-				case '3': dot(); dot(); dot(); dash(); dash(); break; 
-				case '4': dot(); dot(); dot(); dot(); dash(); break; 
-				case '5': dot(); dot(); dot(); dot(); dot(); break; 
-				case '6': dash(); dot(); dot(); dot(); dot(); break; 
-				case '7': dash(); dash(); dot(); dot(); dot(); break; 
-				case '8': dash(); dash(); dash(); dot(); dot(); break; 
-				case '9': dash(); dash(); dash(); dash(); dot(); break; 
-				case '0': dash(); dash(); dash(); dash(); dash(); break; 
-				default: OS_Yield(); break; 
+			/* The sequencer plays the whole character from the OC5 ISR. */ 
+			while (!OS_MorseChar((char)fi)) {
+				OS_Yield(); 
 			}
 			OS_Signal(S_BUZZ_FIFO); 
+			/* When the speaker has finished, signal that output is complete. */ 
+			while (OS_ToneActive()) {
+				OS_Yield(); 
+			}
 			/* Wait for the speaker to settle...prevents the microphone from hearing it. */ 
 			OS_Yield();
-			/* When all buzz processes have finished, signal that output is complete. */ 
-			OS_Wait(S_BUZZ); 
 			OS_Signal(S_BUZZ_OUTPUT); 
-			OS_Signal(S_BUZZ); 
 		}
 		OS_Yield();
 	}
@@ -149,148 +95,103 @@ void FIFOBuzz(void) {
 void ReadLightSensors(void) {
 	FIFO f = (FIFO)OS_GetParam(); 
 	int l, r;
+	BOOL l_above, r_above; 
+	
+	/* Only woken when a photocell crosses its threshold. */ 
+	l = OS_ADCSubscribe(ADC_LEFT_LIGHT,  100, 4, S_LIGHT); 
+	r = OS_ADCSubscribe(ADC_RIGHT_LIGHT, 100, 4, S_LIGHT); 
+	l_above = FALSE; 
+	r_above = FALSE; 
 	
 	while (1) {
-		l = 0; 
-		r = 0; 
-		OS_Wait(S_PORTE); 
-		/* Activate A/D Converter...makes pins on Port E analog. */ 
-		Ports[M6811_OPTION] SET_BIT(BIT7); 
-		/* Delay at least 100 microseconds */ 
-		OS_Yield(); 
+		OS_Wait(S_LIGHT); 
 		
-		/* Start converting the right photocell */ 
-		Ports[M6811_ADCTL] = 0; 
-		/* Wait for conversion to complete. */ 
-		while (!(Ports[M6811_ADCTL] & BIT7)) {
-			OS_Yield(); 
-		}
-		r = Ports[M6811_ADR1]; 
-		
-		/* Start converting the left photocell */ 
-		Ports[M6811_ADCTL] = 1; 
-		/* Wait for conversion to complete. */ 
-		while (!(Ports[M6811_ADCTL] & BIT7)) {
-			OS_Yield(); 
-		}
-		l = Ports[M6811_ADR1];	
-		OS_Signal(S_PORTE); 
-		
-		if (l > 100) {
+		/* Report a photocell when it goes bright. */ 
+		if (OS_ADCAbove(l) && !l_above) {
 			OS_Wait(S_BUZZ_FIFO);
 			OS_Write(f,'l'); 
 		}
 		
-		if (r > 100) {
+		if (OS_ADCAbove(r) && !r_above) {
 			OS_Wait(S_BUZZ_FIFO);
 			OS_Write(f,'r'); 
 		}
 		
-		
-		OS_Yield();
+		l_above = OS_ADCAbove(l); 
+		r_above = OS_ADCAbove(r); 
 	}
 }
 
 void ReadMicrophone(void) {
 	FIFO f = (FIFO)OS_GetParam(); 
-	int s;
+	FIFO m; 
+	int e;
+	
+	/* 
+		Sample at 2 kHz and get one event per block. Sampling pauses 
+		while the speaker plays, so we don't hear our own buzzing. 
+	*/ 
+	m = OS_InitFiFo(); 
+	OS_MicStart(m, 2000); 
 	
 	while (1) {
-		s = 0; 
-		
-		OS_Wait(S_PORTE); 
-		/* Activate A/D Converter...makes pins on Port E analog. */ 
-		Ports[M6811_OPTION] SET_BIT(BIT7); 
-		/* Delay at least 100 microseconds */ 
-		OS_Yield(); 
-		/* Don't listen while buzzing. */ 
-		OS_Wait(S_BUZZ_OUTPUT);
-		/* Start converting the microphone. */ 
-		Ports[M6811_ADCTL] = 2; 
-		OS_Signal(S_BUZZ_OUTPUT);
-		/* Wait for conversion to complete. */ 
-		while (!(Ports[M6811_ADCTL] & BIT7)) {
-			OS_Yield(); 
-		}
-		s = Ports[M6811_ADR1]; 
-		OS_Signal(S_PORTE); 
-		
-		/* Rectify the sound sample around 128. */ 
-		if (s >= 128) { s -= 128; }
-		else          { s = 128 - s; }
-		
-		if (s > 35) {
-			OS_Wait(S_BUZZ_FIFO);
-			OS_Write(f,'s'); 
+		while (OS_Read(m,&e)) {
+			/* Loudest sample in the block. */ 
+			if (((unsigned int)e >> 8) > 35) {
+				OS_Wait(S_BUZZ_FIFO);
+				OS_Write(f,'s'); 
+				break; 
+			}
 		}
 		
-		
 		OS_Yield();
 	}
 }
 
-void ReadBumpers(void) {
-	FIFO f = (FIFO)OS_GetParam(); 
+/* Task: stackless, runs on the kernel stack every 10 ms. */ 
+char ReadBumpers(task *t) {
+	static filter_median m; 
 	int b;
 	
+	TASK_BEGIN(t); 
+	
+	/* A median drops single bad readings while a bumper is settling. */ 
+	FilterMedianInit(&m, 0); 
+	
 	while (1) {
-		b = 0; 
-		OS_Wait(S_PORTE); 
-		/* Activate A/D Converter...makes pins on Port E analog. */ 
-		Ports[M6811_OPTION] SET_BIT(BIT7); 
-		/* Delay at least 100 microseconds */ 
-		OS_Yield(); 
-		/* Start converting the bumpers. */ 
-		Ports[M6811_ADCTL] = 3; 
-		/* Wait for conversion to complete. */ 
-		while (!(Ports[M6811_ADCTL] & BIT7)) {
-			OS_Yield(); 
-		}
-		b = Ports[M6811_ADR1]; 
-		OS_Signal(S_PORTE); 
+		b = FilterMedian3(&m, OS_ADCRead(ADC_BUMPERS)); 
 	
 		/* 
 			Move based on the bumper values. (b)
 		*/ 
 		/* Turn Left */ 
 		if (b > 3 && b < 7) {
-			Ports[M6811_DDRD]  = 0xFF;
-			Ports[M6811_PORTD] CLR_BIT(BIT5); // Reverse Right 			
-
-			Ports[M6811_PORTA] CLR_BIT(BIT6); // Left
-			Ports[M6811_PORTA] SET_BIT(BIT5); // Right
+			OS_MotorSet(0, -BUMP_SPEED); // Reverse Right 
 			
 			//OS_Write(f,1); 
 		}
 		/* Turn Right */ 
 		else if (b > 23 && b < 26) {
-			Ports[M6811_DDRD]  = 0xFF;
-			Ports[M6811_PORTD] CLR_BIT(BIT4); // Reverse Left
-
-			Ports[M6811_PORTA] SET_BIT(BIT6); // Left
-			Ports[M6811_PORTA] CLR_BIT(BIT5); // Right
+			OS_MotorSet(-BUMP_SPEED, 0); // Reverse Left 
 
 			//OS_Write(f,2); 
 		}
 		/* Move Ahead */ 
 		else if (b > 67 && b < 70) {
-			Ports[M6811_DDRD]  = 0xFF;
-			Ports[M6811_PORTD] = 0xFF; // Forward
-			
-			Ports[M6811_PORTA] SET_BIT(BIT6); // Left
-			Ports[M6811_PORTA] SET_BIT(BIT5); // Right
+			OS_MotorSet(BUMP_SPEED, BUMP_SPEED); // Forward 
 						
 			//OS_Write(f,3); 
 		}
 		/* Stop */ 
 		else {
-			Ports[M6811_PORTA] CLR_BIT(BIT6); 
-			Ports[M6811_PORTA] CLR_BIT(BIT5); 
+			OS_MotorSet(0, 0); 
 		
 			//OS_Write(f,4);  
 		}
-		OS_Yield();
+		TASK_YIELD(t); 
 	}
+	
+	TASK_END(t); 
 }
 
 
@@ -352,15 +253,10 @@ void PrintLogo(void) {
 	OS_Create(PrintFIFO, (int)f, PERIODIC, 30);
 	
 	/* Buzz SOS */ 
-	dot();
-	dot(); 
-	dot();
-	dash();
-	dash();
-	dash();
-	dot();
-	dot();
-	dot();
+	OS_Morse("sos"); 
+	while (OS_ToneActive()) {
+		OS_Yield(); 
+	}
 	OS_Signal(S_BUZZ_OUTPUT);
 }
 
@@ -8,28 +8,28 @@
 #ifndef __TEST_H__
 #define __TEST_H__
 
-#define S_BUZZ       15
+#include "task.h"
+
 #define S_BUZZ_FIFO  14
-#define S_PORTE      13
+#define S_LIGHT      13
 #define S_LCD_FIFO   12
 #define S_LCD        11
 #define S_LOGO       10
 
 #define S_BUZZ_OUTPUT 10
 
-inline void dot(void);
-inline void dash(void);
+/* Motor speed, in percent, when moving away from a bump. */ 
+#define BUMP_SPEED   100
 
 void ProcessInit(void);	
 
 void TestMain(void);
 
-void Buzz(void);
 void BuzzString(void);
 void FIFOBuzz(void);
 void ReadLightSensors(void);
 void ReadMicrophone(void);
-void ReadBumpers(void);
+char ReadBumpers(task *t);
 void PrintBumperValue(void);
 void PrintString(void);
 
@@ -41,7 +41,6 @@ void PrintFIFO(void);
 
 /*****************/
 void Test2(void);
-void DetectObject(void);
 void PrintFIFOInt(void);
 /*****************/
 
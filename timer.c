@@ -0,0 +1,140 @@
+/*
+ * timer.c
+ * Software timers.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#include "timer.h"
+
+timer Timers[MAXTIMER];
+
+static timer *TimerList;    /* Armed timers, earliest expiry first. */
+
+/* Take timer tm out of the expiry list. Interrupts must be masked. */
+static void TimerRemove(timer *tm) {
+	timer **l;
+
+	for (l = &TimerList; *l; l = &((*l)->Next)) {
+		if (*l == tm) {
+			*l = tm->Next;
+			break;
+		}
+	}
+	tm->Next  = 0;
+	tm->Armed = FALSE;
+}
+
+/* Put timer tm in the expiry list, after any timer due at the same time. Interrupts must be masked. */
+static void TimerInsert(timer *tm) {
+	timer **l;
+
+	for (l = &TimerList; *l && (*l)->Expiry <= tm->Expiry; l = &((*l)->Next));
+	tm->Next  = *l;
+	*l        = tm;
+	tm->Armed = TRUE;
+}
+
+int OS_TimerCreate(void (*f)(int), int arg) {
+	timer *tm;
+	int i;
+	int id = INVALIDTIMER;
+	BOOL I;
+
+	I = CheckInterruptMask();
+	OS_DI();
+
+	for (i = 0; i < MAXTIMER; i++) {
+		tm = &Timers[i];
+		if (!tm->Used) {
+			tm->Used   = TRUE;
+			tm->Armed  = FALSE;
+			tm->Period = 0;
+			tm->Arg    = arg;
+			tm->f      = f;
+			tm->Next   = 0;
+			id = i;
+			break;
+		}
+	}
+
+	if (!I) { OS_EI(); }
+	return id;
+}
+
+BOOL OS_TimerStart(int id, unsigned int delay, unsigned int period) {
+	timer *tm;
+	BOOL I;
+
+	if (id < 0 || id >= MAXTIMER || !Timers[id].Used) { return FALSE; }
+	tm = &Timers[id];
+
+	I = CheckInterruptMask();
+	OS_DI();
+
+	if (tm->Armed) { TimerRemove(tm); }
+
+	/* Clock only moves in the kernel; bring it up to date before using it. */
+	ClockUpdate();
+	tm->Expiry = Clock + (delay ? delay : 1);
+	tm->Period = period;
+	TimerInsert(tm);
+
+	/* If a process is running past the expiry, come back to the kernel in time for it. */
+	PreemptAt(tm->Expiry);
+
+	if (!I) { OS_EI(); }
+	return TRUE;
+}
+
+void OS_TimerStop(int id) {
+	BOOL I;
+
+	if (id < 0 || id >= MAXTIMER) { return; }
+
+	I = CheckInterruptMask();
+	OS_DI();
+
+	if (Timers[id].Armed) { TimerRemove(&Timers[id]); }
+
+	if (!I) { OS_EI(); }
+}
+
+void OS_TimerDelete(int id) {
+	BOOL I;
+
+	if (id < 0 || id >= MAXTIMER) { return; }
+
+	I = CheckInterruptMask();
+	OS_DI();
+
+	if (Timers[id].Armed) { TimerRemove(&Timers[id]); }
+	Timers[id].Used = FALSE;
+
+	if (!I) { OS_EI(); }
+}
+
+BOOL RunTimers(time_t *next) {
+	timer *tm;
+
+	while ((tm = TimerList) && tm->Expiry <= Clock) {
+		TimerRemove(tm);
+
+		/* Periodic timers are re-armed first, so the callback is free to stop them. */
+		if (tm->Period) {
+			tm->Expiry += tm->Period;
+			/* Don't try to catch up on periods that were missed entirely. */
+			if (tm->Expiry <= Clock) { tm->Expiry = Clock + tm->Period; }
+			TimerInsert(tm);
+		}
+
+		OS_EI();
+		tm->f(tm->Arg);
+		OS_DI();
+	}
+
+	if (!TimerList) { return FALSE; }
+	*next = TimerList->Expiry;
+	return TRUE;
+}
@@ -0,0 +1,63 @@
+/*
+ * timer.h
+ * Software timers. One-shot and periodic timers are kept in a single list 
+ * sorted by expiry time, and their callbacks are run by the scheduler on 
+ * the kernel stack, so a timer costs a few bytes instead of a process and 
+ * its stack. The earliest expiry is folded into the OC4 preemption time. 
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+#include "os.h"
+#include "process.h"
+
+#define MAXTIMER          16     /* max. # of timers supported */
+#define INVALIDTIMER      -1     /* an invalid timer descriptor */
+
+typedef struct timer_struct {
+	BOOL Used;                         /* Allocated by OS_TimerCreate().        */
+	BOOL Armed;                        /* In the expiry list.                   */
+	unsigned int Period;               /* Reload in ms, 0 for a one-shot timer. */
+	int Arg;                           /* Callback argument.                    */
+	void (*f)(int);                    /* Callback.                             */
+	time_t Expiry;                     /* Fire at this time.                    */
+	struct timer_struct *Next;         /* Next timer to expire.                 */
+} timer;
+
+/*
+   Allocate a timer that calls "f(arg)" when it expires. The timer is 
+   created stopped. Returns the timer descriptor, or INVALIDTIMER if none 
+   is free. 
+*/
+int OS_TimerCreate(void (*f)(int), int arg);
+
+/*
+   Arm timer "id" to expire "delay" ms from now, and then every "period" ms 
+   if "period" is non-zero. A timer that is already armed is re-armed. If a 
+   process arms a timer that is due before its own preemption time, it is 
+   preempted early so the callback is not late. Returns FALSE if "id" is 
+   not a valid timer. 
+*/
+BOOL OS_TimerStart(int id, unsigned int delay, unsigned int period);
+
+/* Disarm timer "id". Its callback will not be called until it is started again. */
+void OS_TimerStop(int id);
+
+/* Disarm timer "id" and free it. */
+void OS_TimerDelete(int id);
+
+/*
+   Kernel only: call back every timer that has expired, with interrupts 
+   enabled. Callbacks run one at a time in expiry order, must not call 
+   anything that blocks or yields (OS_Wait(), OS_Yield()), and may start 
+   or stop any timer, including their own. 
+   Stores the time the next timer expires in "next" and returns TRUE, or 
+   returns FALSE if none are armed. 
+*/
+BOOL RunTimers(time_t *next);
+
+#endif /* __TIMER_H__ */
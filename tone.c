@@ -0,0 +1,219 @@
+/*
+ * tone.c
+ * Hardware tone generation on PA3/OC5.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#include "tone.h"
+
+ISR_STUB(ToneISR, ToneHandler)
+
+typedef struct tone_step {
+	unsigned int HalfPeriod;     /* Ticks between edges, 0 for a rest.        */
+	unsigned int Edges;          /* Compares in this step, 0 if unlimited.    */
+} tone_step;
+
+static tone_step ToneQueue[TONE_QUEUE_SIZE];
+static volatile int ToneQueueRead;
+static volatile int ToneQueueWrite;
+static volatile int ToneQueueCount;
+
+static volatile unsigned int ToneHalfPeriod; /* Ticks between compares of the current step.  */
+static volatile unsigned int ToneEdges;      /* Compares left in this step, 0 if unlimited. */
+static volatile BOOL         ToneOn;         /* A step is currently being played.           */
+
+static interrupt_t ToneIdle;                 /* OC5 vector while no tone is playing.        */
+static unsigned int ToneIdlePeriod;          /* Ticks between ToneIdle interrupts.          */
+
+/*
+   Disconnect OC5 from the pin and leave the speaker low. If an idle handler
+   is set, OC5 is handed to it, first interrupting ToneIdlePeriod after "base".
+   Interrupts must be masked.
+*/
+static void ToneStop(unsigned int base) {
+	/* OM5:OL5 = 0:0, PA3 becomes a general purpose output again. */
+	Ports[M6811_TCTL1] CLR_BIT(M6811_BIT1);
+	Ports[M6811_TCTL1] CLR_BIT(M6811_BIT0);
+	Ports[M6811_PORTA] CLR_BIT(M6811_BIT3);
+	ToneOn = FALSE;
+
+	if (ToneIdle) {
+		TOC5V = ToneIdle;
+		*(unsigned int*)&(Ports[M6811_TOC5_HIGH]) = base + ToneIdlePeriod;
+		/* Clear OC5F */
+		Ports[M6811_TFLG1] = M6811_BIT3;
+		/* Unmask OC5 interrupt */
+		Ports[M6811_TMSK1] SET_BIT(M6811_BIT3);
+	}
+	else {
+		/* Mask OC5 interrupt */
+		Ports[M6811_TMSK1] CLR_BIT(M6811_BIT3);
+	}
+}
+
+/* Convert a frequency and duration into compare reloads. */
+static void ToneMakeStep(tone_step *s, unsigned int freq, unsigned int duration) {
+	unsigned long edges;
+
+	/* A rest counts 1 ms compares with the pin disconnected. */
+	if (!freq) {
+		s->HalfPeriod = 0;
+		s->Edges      = duration;
+		return;
+	}
+
+	s->HalfPeriod = TONE_HALF_PERIOD_TICKS / freq;
+	if (s->HalfPeriod < TONE_MIN_HALF_PERIOD) {
+		s->HalfPeriod = TONE_MIN_HALF_PERIOD;
+	}
+
+	/* One edge per half period, duration in ms, from the half period actually played. Keep it even so the speaker ends low. */
+	edges = ((unsigned long)duration * TIME_QUANTUM) / s->HalfPeriod;
+	/* 0 would mean play forever; a short note at a low pitch still gets one cycle. */
+	if (duration && !edges)  { edges = 1; }
+	edges = (edges + 1) & ~1UL;
+	if (edges > 0xFFFE)      { edges = 0xFFFE; }
+	s->Edges = (unsigned int)edges;
+}
+
+/*
+   Start playing step s, with its first compare one period after "base".
+   Interrupts must be masked.
+*/
+static void ToneStart(tone_step *s, unsigned int base) {
+	unsigned int *TOC5_address;
+
+	ToneHalfPeriod = s->HalfPeriod ? s->HalfPeriod : TIME_QUANTUM;
+	ToneEdges      = s->Edges;
+	ToneOn         = TRUE;
+
+	TOC5V = ToneISR;
+
+	/* Make sure this is written as a single 16 bit number. */
+	TOC5_address  = (unsigned int*)&(Ports[M6811_TOC5_HIGH]);
+	*TOC5_address = base + ToneHalfPeriod;
+
+	/* Clear OC5F. Flags are cleared by writing a one, so don't read-modify-write. */
+	Ports[M6811_TFLG1] = M6811_BIT3;
+	/* OM5:OL5 = 0:1 toggles PA3 on each compare; 0:0 leaves it low for a rest. */
+	Ports[M6811_TCTL1] CLR_BIT(M6811_BIT1);
+	if (s->HalfPeriod) { Ports[M6811_TCTL1] SET_BIT(M6811_BIT0); }
+	else               { Ports[M6811_TCTL1] CLR_BIT(M6811_BIT0); }
+	/* Unmask OC5 interrupt */
+	Ports[M6811_TMSK1] SET_BIT(M6811_BIT3);
+}
+
+void OS_Tone(unsigned int freq, unsigned int duration) {
+	tone_step s;
+	unsigned int *timer_address;
+	BOOL I;
+
+	I = CheckInterruptMask();
+	OS_DI();
+
+	/* Drop anything queued; this tone replaces it. */
+	ToneQueueRead  = 0;
+	ToneQueueWrite = 0;
+	ToneQueueCount = 0;
+
+	timer_address = (unsigned int*)&(Ports[M6811_TCNT_HIGH]);
+	if (freq) {
+		ToneMakeStep(&s, freq, duration);
+		ToneStart(&s, *timer_address);
+	}
+	else {
+		ToneStop(*timer_address);
+	}
+
+	if (!I) { OS_EI(); }
+}
+
+BOOL OS_ToneQueue(unsigned int freq, unsigned int duration) {
+	tone_step *s;
+	unsigned int *timer_address;
+	BOOL I;
+
+	if (!duration) { return TRUE; }
+
+	I = CheckInterruptMask();
+	OS_DI();
+
+	if (ToneQueueCount >= TONE_QUEUE_SIZE) {
+		if (!I) { OS_EI(); }
+		return FALSE;
+	}
+
+	s = &ToneQueue[ToneQueueWrite];
+	ToneMakeStep(s, freq, duration);
+
+	/* If nothing is playing, start this step right away. */
+	if (!ToneOn) {
+		timer_address = (unsigned int*)&(Ports[M6811_TCNT_HIGH]);
+		ToneStart(s, *timer_address);
+	}
+	else {
+		circularIncrement((int *)&ToneQueueWrite, TONE_QUEUE_SIZE);
+		ToneQueueCount++;
+	}
+
+	if (!I) { OS_EI(); }
+	return TRUE;
+}
+
+int OS_ToneQueueFree(void) {
+	return TONE_QUEUE_SIZE - ToneQueueCount;
+}
+
+BOOL OS_ToneActive(void) {
+	return ToneOn;
+}
+
+void OS_ToneIdle(interrupt_t f, unsigned int period) {
+	BOOL I;
+
+	I = CheckInterruptMask();
+	OS_DI();
+
+	ToneIdle       = f;
+	ToneIdlePeriod = period;
+	if (!ToneOn) {
+		ToneStop(*(unsigned int*)&(Ports[M6811_TCNT_HIGH]));
+	}
+
+	if (!I) { OS_EI(); }
+}
+
+void ToneHandler(void) {
+	unsigned int *TOC5_address;
+	unsigned int last;
+
+	/* Advance from the last compare rather than from TCNT, so latency doesn't bend the pitch. */
+	TOC5_address  = (unsigned int*)&(Ports[M6811_TOC5_HIGH]);
+	last          = *TOC5_address;
+
+	/* Nothing playing; a compare left over from a stopped tone. */
+	if (!ToneOn) {
+		/* Clear OC5F */
+		Ports[M6811_TFLG1] = M6811_BIT3;
+		return;
+	}
+
+	*TOC5_address = last + ToneHalfPeriod;
+
+	/* Clear OC5F */
+	Ports[M6811_TFLG1] = M6811_BIT3;
+
+	if (ToneEdges && !(--ToneEdges)) {
+		/* Chain straight into the next queued step so there's no gap. */
+		if (ToneQueueCount) {
+			ToneStart(&ToneQueue[ToneQueueRead], last);
+			circularIncrement((int *)&ToneQueueRead, TONE_QUEUE_SIZE);
+			ToneQueueCount--;
+		}
+		else {
+			ToneStop(last);
+		}
+	}
+}
@@ -0,0 +1,69 @@
+/*
+ * tone.h
+ * Hardware tone generation on PA3/OC5.
+ *
+ * Authors:
+ * 	Joel Goguen <r1hh8@unb.ca>
+ *	Andrew Somerville <z19ar@unb.ca>
+ */
+#ifndef __TONE_H__
+#define __TONE_H__
+
+#include "os.h"
+#include "ports.h"
+#include "interrupts.h"
+#include "process.h"
+#include "isr.h"
+
+/* Timer ticks in half a second; divided by the frequency this gives the half period. */
+#define TONE_HALF_PERIOD_TICKS (TIME_QUANTUM * 500U)
+
+/*
+   Shortest half period in ticks (320 usec, so at most about 1.5 kHz). A
+   reload through ToneISR, ISREnter and ToneHandler costs around 300
+   E-cycles (150 usec), so this leaves at least half the CPU to the rest
+   of the system.
+*/
+#define TONE_MIN_HALF_PERIOD 40
+
+/* Number of steps that can be queued behind the playing one. */
+#define TONE_QUEUE_SIZE 32
+
+/*
+   Play a tone of "freq" Hz on the speaker for "duration" ms. OC5 toggles PA3
+   in hardware, and a short ISR reloads the compare register on each edge, so
+   no process time is used while the tone plays.
+   A duration of 0 plays until the next call. A frequency of 0 silences the
+   speaker. Any tone already playing, and anything queued, is replaced.
+*/
+void OS_Tone(unsigned int freq, unsigned int duration);
+
+/*
+   Append a step of "freq" Hz (0 for a rest) lasting "duration" ms to the
+   tone queue. Steps play back to back from the OC5 ISR, with no gaps and
+   no process involvement. Returns FALSE if the queue is full.
+*/
+BOOL OS_ToneQueue(unsigned int freq, unsigned int duration);
+
+/* Number of steps that can still be queued. */
+int OS_ToneQueueFree(void);
+
+/* Non-zero while a tone or rest is playing, or steps are queued. */
+BOOL OS_ToneActive(void);
+
+/*
+   Lend OC5 out while the speaker is silent: "f" becomes the OC5 vector
+   whenever no tone or rest is playing, with its first compare "period"
+   ticks after the speaker goes quiet, and ToneISR takes the vector back
+   while one plays. "f" is a complete interrupt handler: it must advance
+   TOC5, clear OC5F and end in rti. Pass a null "f" to stop.
+*/
+void OS_ToneIdle(interrupt_t f, unsigned int period);
+
+/* Reloads TOC5 on each edge and stops the tone when its duration is up. */
+void ToneHandler(void);
+
+/* OC5 vector, entering ToneHandler() on the interrupt stack. */
+void ToneISR(void);
+
+#endif /* __TONE_H__ */
@@ -10,6 +10,10 @@
 #include "os.h"
 #include "ports.h"
 #include "process.h"
+#include "ir.h"
+#include "adc.h"
+#include "filter.h"
+#include "format.h"
 
 void ProcessInit () {
 	PPPLen    = 3;
@@ -31,27 +35,11 @@ void ProcessInit () {
 
 /* Specific to this implementation. */
 void PrintTime (void) {
-	time_t time = 0;
 	char *time_s = " 00:00.00";
-
-	time_t cs;
-	time_t s;
-	time_t m;
 	
 	while (1) {
-		time = Clock/10;
-
-		cs = time % 100; 
-		time /= 100; 
-		s = time % 60;
-		m = time / 60;
-
-		time_s[8] = cs % 10 + '0';  
-		time_s[7] = (cs / 10) % 10 + '0';
-		time_s[5] = s % 10 + '0';  
-		time_s[4] = (s / 10) % 10 + '0';  
-		time_s[2] = m % 10 + '0';  
-		time_s[1] = (m / 10) % 10 + '0';  
+		/* Clock counts ms; written over the digits of the template. */ 
+		FormatTime(&time_s[1], (unsigned long)Clock);
 
 		sys_print_lcd(time_s);
 		OS_Yield();
@@ -76,10 +64,10 @@ void Buzz(void) {
 void Test2(void) {
 	FIFO f;
 
-	OS_InitSem(S_PORTE,1);
+	OS_ADCInit(); 
 	f = OS_InitFiFo(); 
 
-	OS_Create(DetectObject, (int)f, DEVICE, 5);
+	OS_Create(IRDriver, (int)f, DEVICE, IR_PERIOD);
 	//OS_Create(ReadLightSensors, (int)f, DEVICE, 10);
 	OS_Create(PrintFIFOInt, (int)f, PERIODIC, 20);
 }
@@ -87,82 +75,19 @@ void Test2(void) {
 void ReadLightSensors(void) {
 	FIFO f = (FIFO)OS_GetParam(); 
 	int l, r;
+	filter_smooth fl, fr; 
 	
-	while (1) {
-		l = 0; 
-		r = 0; 
-		OS_Wait(S_PORTE); 
-		/* Activate A/D Converter...makes pins on Port E analog. */ 
-		Ports[M6811_OPTION] SET_BIT(BIT7); 
-		/* Delay at least 100 microseconds */ 
-		OS_Yield(); 
-		
-		/* Start converting the right photocell */ 
-		Ports[M6811_ADCTL] = 0; 
-		/* Wait for conversion to complete. */ 
-		while (!(Ports[M6811_ADCTL] & BIT7)) {
-			OS_Yield(); 
-		}
-		r = Ports[M6811_ADR1]; 
-		
-		/* Start converting the left photocell */ 
-		Ports[M6811_ADCTL] = 1; 
-		/* Wait for conversion to complete. */ 
-		while (!(Ports[M6811_ADCTL] & BIT7)) {
-			OS_Yield(); 
-		}
-		l = Ports[M6811_ADR1]; 
-		
-		OS_Write(f,l+(r*256)); 
-		
-		OS_Signal(S_PORTE); 
-		OS_Yield();
-	}
-}
-
-
-void DetectObject(void) {
-	FIFO f = (FIFO)OS_GetParam(); 
-	int l, r;
+	/* Smooth out flicker before publishing. */ 
+	FilterSmoothInit(&fl, 2, OS_ADCRead(ADC_LEFT_LIGHT)); 
+	FilterSmoothInit(&fr, 2, OS_ADCRead(ADC_RIGHT_LIGHT)); 
 	
 	while (1) {
-		l = 0; 
-		r = 0; 
-	
-		OS_Wait(S_PORTE); 
-		/* Deactivate A/D Converter...makes pins on Port E analog. */ 
-		Ports[M6811_OPTION] CLR_BIT(BIT7); 
-		/* Delay at least 100 microseconds */ 
-		OS_Yield(); 
-		
-		/* Turn on left emitter */ 
-		Ports[M6811_PORTD] SET_BIT(BIT4); 
-		/* Delay at least 600 microseconds */ 
-		OS_Yield(); 
-		/* Check for detection. */ 
-		l = Ports[M6811_PORTE];
-		/* Turn off emitter */ 
-		Ports[M6811_PORTD] SET_BIT(BIT4); 
-		OS_Yield(); 
-		/* Check for detection. */ 
-		l = (l & (Ports[M6811_PORTE] & BIT4))?1:0;
-		OS_Yield(); 
-		
-		/* Turn on Right emitter */ 
-		Ports[M6811_PORTD] SET_BIT(BIT5); 
-		/* Delay at least 600 microseconds */ 
-		OS_Yield(); 
-		/* Check for detection. */ 
-		r = Ports[M6811_PORTE];
-		/* Turn off emitter */ 
-		Ports[M6811_PORTD] SET_BIT(BIT5); 
-		OS_Yield(); 
-		/* Check for detection. */ 
-		r = (r & Ports[M6811_PORTE] & BIT4)?1:0;
+		/* The ADC service keeps the latest photocell values. */ 
+		r = FilterSmooth(&fr, OS_ADCRead(ADC_RIGHT_LIGHT)); 
+		l = FilterSmooth(&fl, OS_ADCRead(ADC_LEFT_LIGHT)); 
 		
 		OS_Write(f,l+(r*256)); 
 		
-		OS_Signal(S_PORTE); 
 		OS_Yield();
 	}
 }
@@ -172,23 +97,12 @@ void PrintFIFOInt (void) {
 	FIFO f = (FIFO)OS_GetParam(); 
 	char *s = "                "; 
 	int fi; 
-	int l; 
-	int r; 
 
 	while (1) {
 		if(OS_Read(f,&fi)) {
-			l = fi % 256; 
-			r = fi / 256; 
-			
-			s[9] = r % 10 + '0';  
-			s[8] = (r /= 10) % 10 + '0';
-			s[7] = (r /= 10) % 10 + '0';
-			s[6] = (r /= 10) % 10 + '0';
-			
-			s[4] = l % 10 + '0';  
-			s[3] = (l /= 10) % 10 + '0';
-			s[2] = (l /= 10) % 10 + '0';
-			s[1] = (l /= 10) % 10 + '0';
+			/* Low byte at 1-4, high byte at 6-9. */ 
+			FormatDigits(&s[1], fi & 0xFF, 4); 
+			FormatDigits(&s[6], (unsigned int)fi >> 8, 4); 
 		} 
 		sys_print_lcd(s);
 		OS_Yield(); 
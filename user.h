@@ -9,14 +9,12 @@
 #define __USER_H__
 
 #define S_BUZZ  15
-#define S_PORTE 14
 
 void ProcessInit(void);	
 
 /*****************/
 void Test2(void);
 void ReadLightSensors(void);
-void DetectObject(void);
 void PrintFIFOInt(void);
 /*****************/ 
 void Buzz(void);